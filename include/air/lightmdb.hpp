@@ -1,4 +1,11 @@
 #pragma once
 
 #include "air/lightmdb/fixed.hpp"
-#include "air/lightmdb/variable.hpp"
\ No newline at end of file
+#include "air/lightmdb/variable.hpp"
+#include "air/lightmdb/framed.hpp"
+#include "air/lightmdb/ring.hpp"
+#include "air/lightmdb/cursor.hpp"
+#include "air/lightmdb/consumer.hpp"
+#include "air/lightmdb/sparse.hpp"
+#include "air/lightmdb/columnar.hpp"
+#include "air/lightmdb/async.hpp"
\ No newline at end of file
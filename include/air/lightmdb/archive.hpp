@@ -0,0 +1,268 @@
+#pragma once
+
+#include <string_view>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "air/lightmdb/core.hpp"
+#include "air/lightmdb/fixed.hpp"
+#include "air/lightmdb/compress.hpp"
+
+namespace air
+{
+    namespace lightmdb
+    {
+        namespace detail
+        {
+            /// 变长数据的压缩归档: 连续下标的数据按块压缩后追加到 name + "z", 块索引保存在 name + "zi"
+            /// 原始块为 uint32 条数, 每条数据的 uint32 结束偏移 (最高位表示跳过标记), 之后是各条数据; 压缩不划算的块原样保存
+            /// 读取时只解压所在的块, 最近使用的 cache_blocks 个块保留在本地缓存中; 同一时刻只有一个进程追加, 由 "z" 的可恢复锁 (mmap::lock_owner) 互斥
+            class block_archive
+            {
+            public:
+                using size_type = std::size_t;
+
+                /// 本地缓存的解压块数
+                static constexpr size_type cache_blocks = 4;
+
+                /// 读取 append 的一条数据
+                struct record
+                {
+                    const void *data;
+                    size_type size;
+                    bool skipped;
+                };
+
+            private:
+                struct block
+                {
+                    /// 块中第一条数据的下标与条数
+                    std::uint64_t first;
+                    std::uint64_t count;
+                    /// 压缩数据在 "z" 中的偏移与字节数, stored 等于 raw 时为原样保存
+                    std::uint64_t offset;
+                    std::uint32_t stored;
+                    std::uint32_t raw;
+                };
+
+                struct cached
+                {
+                    size_type block = std::numeric_limits<size_type>::max();
+                    std::uint64_t used = 0;
+                    std::vector<char> data;
+                };
+
+                static constexpr std::uint32_t skip_flag = std::uint32_t(1) << 31;
+
+                // header.size 为已使用的字节数, header.owner 为追加锁; 追加中崩溃时由下一个追加者接管
+                // 数据先写入再推进 size, 块写完后才加入块索引, 接管时未登记的字节只是浪费, 不会被读到
+                mmap data_;
+                fixed::table<block> blocks_;
+
+                std::array<cached, cache_blocks> cache_;
+                std::uint64_t clock_ = 0;
+                // 最近一次读取的缓存项
+                cached *last_ = nullptr;
+
+                /// 追加一个原始块, 调用者持有追加锁
+                void do_append(size_type first, size_type count, const std::vector<char> &raw)
+                {
+                    std::vector<char> compressed(lz4::compress_bound(raw.size()));
+                    auto size = lz4::compress(raw.data(), raw.size(), compressed.data());
+                    auto src = size < raw.size() ? compressed.data() : raw.data();
+                    size = (std::min)(size, raw.size());
+
+                    auto offset = data_.size();
+                    while (offset + size > data_.get_header().capacity)
+                        data_.recapacity();
+                    if (offset + size > data_.capacity())
+                        data_.remmap();
+
+                    memcpy(data_.template at<char>(offset), src, size);
+                    data_.get_header().size.store(offset + size, boost::memory_order_release);
+                    blocks_.push({first, count, offset, static_cast<std::uint32_t>(size), static_cast<std::uint32_t>(raw.size())});
+                }
+
+                /// 下标 index 所在块的解压数据, 调用者保证 index 已归档
+                cached &load(size_type index)
+                {
+                    if (last_ != nullptr && index - blocks_[last_->block].first < blocks_[last_->block].count)
+                        return *last_;
+
+                    // 最后一个第一条数据不大于 index 的块
+                    size_type lo = 0, hi = blocks_.committed();
+                    while (hi - lo > 1)
+                    {
+                        auto mid = lo + (hi - lo) / 2;
+                        if (blocks_[mid].first <= index)
+                            lo = mid;
+                        else
+                            hi = mid;
+                    }
+
+                    auto victim = &cache_[0];
+                    for (auto &entry : cache_)
+                    {
+                        if (entry.block == lo)
+                        {
+                            victim = &entry;
+                            break;
+                        }
+                        if (entry.used < victim->used)
+                            victim = &entry;
+                    }
+
+                    if (victim->block != lo)
+                    {
+                        auto val = blocks_[lo];
+                        while (val.offset + val.stored > data_.capacity())
+                            data_.remmap();
+
+                        auto src = data_.template at<char>(val.offset);
+                        victim->data.resize(val.raw);
+                        victim->block = lo;
+                        if (val.stored == val.raw)
+                            memcpy(victim->data.data(), src, val.raw);
+                        else if (!lz4::decompress(src, val.stored, victim->data.data(), val.raw))
+                        {
+                            victim->block = std::numeric_limits<size_type>::max();
+                            throw std::runtime_error("corrupted archive block " + std::to_string(lo) + " in " + data_.name());
+                        }
+                    }
+
+                    victim->used = ++clock_;
+                    last_ = victim;
+                    return *victim;
+                }
+
+                /// 块内第 k 条数据的结束偏移
+                static std::uint32_t end_of(const cached &val, size_type k)
+                {
+                    std::uint32_t end;
+                    memcpy(&end, val.data.data() + sizeof(std::uint32_t) * (k + 1), sizeof(end));
+                    return end;
+                }
+
+            public:
+                static std::string file_name(std::string_view name)
+                {
+                    return std::string(name) + "z";
+                }
+
+                /// 创建或打开归档, capacity 为数据文件的初始字节数
+                block_archive(std::string_view name, mode_t mode, size_type capacity, const options &opts = {})
+                    : data_(file_name(name), mode, capacity, opts), blocks_(file_name(name) + "i", mode, 64, opts)
+                {
+                }
+
+                block_archive(std::string_view name, mode_t mode, const options &opts = {})
+                    : data_(file_name(name), mode, opts), blocks_(file_name(name) + "i", mode, opts)
+                {
+                }
+
+                /// 已归档的数据条数, 之前的下标都可以从归档读取
+                size_type archived() const
+                {
+                    auto count = blocks_.committed();
+                    if (count == 0)
+                        return 0;
+
+                    auto &back = blocks_[count - 1];
+                    return static_cast<size_type>(back.first + back.count);
+                }
+
+                /// 把 [archived(), last) 按每块约 block_size 字节原始数据归档, read(index) 返回 record, 返回 archived()
+                /// 单条超过 block_size 的数据单独成块
+                template <typename Read>
+                size_type append(size_type last, size_type block_size, Read &&read)
+                {
+                    if (!data_.writable())
+                        throw std::runtime_error("archive requires a writable mapping " + data_.name());
+
+                    data_.lock_owner();
+                    auto first = this->archived();
+                    std::vector<std::uint32_t> ends;
+                    std::vector<char> payload, raw;
+
+                    auto flush = [&](size_type next)
+                    {
+                        raw.resize(sizeof(std::uint32_t) * (ends.size() + 1) + payload.size());
+                        auto count = static_cast<std::uint32_t>(ends.size());
+                        memcpy(raw.data(), &count, sizeof(count));
+                        memcpy(raw.data() + sizeof(count), ends.data(), sizeof(std::uint32_t) * ends.size());
+                        memcpy(raw.data() + sizeof(count) * (ends.size() + 1), payload.data(), payload.size());
+                        this->do_append(next - ends.size(), ends.size(), raw);
+                        ends.clear();
+                        payload.clear();
+                    };
+
+                    try
+                    {
+                        for (auto index = first; index < last; ++index)
+                        {
+                            auto val = read(index);
+                            if (val.size >= skip_flag || payload.size() + val.size >= skip_flag)
+                                throw std::runtime_error("archive block too large in " + data_.name());
+
+                            if (!val.skipped)
+                                payload.insert(payload.end(), static_cast<const char *>(val.data), static_cast<const char *>(val.data) + val.size);
+                            ends.push_back(static_cast<std::uint32_t>(payload.size()) | (val.skipped ? skip_flag : 0));
+
+                            if (payload.size() >= block_size)
+                                flush(index + 1);
+                        }
+                        if (!ends.empty())
+                            flush(last);
+                    }
+                    catch (...)
+                    {
+                        data_.unlock_owner();
+                        throw;
+                    }
+
+                    data_.unlock_owner();
+                    return this->archived();
+                }
+
+                /// 已归档的第 index 条数据, 指针在之后读取 cache_blocks 个其他块之前有效
+                std::pair<const void *, size_type> get(size_type index)
+                {
+                    auto &val = this->load(index);
+                    auto k = index - blocks_[val.block].first;
+                    std::uint32_t count;
+                    memcpy(&count, val.data.data(), sizeof(count));
+
+                    auto begin = k == 0 ? 0 : end_of(val, k - 1) & ~skip_flag;
+                    auto end = end_of(val, k) & ~skip_flag;
+                    return {val.data.data() + sizeof(std::uint32_t) * (count + 1) + begin, end - begin};
+                }
+
+                /// 已归档的第 index 条数据是否为跳过标记
+                bool skipped(size_type index)
+                {
+                    auto &val = this->load(index);
+                    return (end_of(val, index - blocks_[val.block].first) & skip_flag) != 0;
+                }
+
+                /// 压缩后的字节数
+                size_type bytes() const
+                {
+                    return data_.size();
+                }
+
+                const std::string &name() const
+                {
+                    return data_.name();
+                }
+            };
+        }
+    }
+}
\ No newline at end of file
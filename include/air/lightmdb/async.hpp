@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <ctime>
+#endif
+
+#include "air/lightmdb/core.hpp"
+
+namespace air
+{
+    namespace lightmdb
+    {
+        /// 协程等待: 一个线程通过 reactor 同时等待多个 table, 不必每个 table 占用一个阻塞线程
+        namespace async
+        {
+            class reactor;
+
+            /// reactor 的等待体, ready 返回 true 时恢复协程, co_await 的结果为 resume()
+            template <typename Ready, typename Resume>
+            class awaiter
+            {
+                reactor &reactor_;
+                detail::mmap &mmap_;
+                Ready ready_;
+                Resume resume_;
+
+                static bool check(void *self)
+                {
+                    return static_cast<awaiter *>(self)->ready_();
+                }
+
+            public:
+                awaiter(reactor &reactor, detail::mmap &mmap, Ready ready, Resume resume)
+                    : reactor_(reactor), mmap_(mmap), ready_(std::move(ready)), resume_(std::move(resume))
+                {
+                }
+
+                bool await_ready()
+                {
+                    return ready_();
+                }
+
+                bool await_suspend(std::coroutine_handle<> handle);
+
+                decltype(auto) await_resume()
+                {
+                    return resume_();
+                }
+            };
+
+            /// 单线程的协程调度器, 不是线程安全的, 挂起与 run_once 必须在同一线程中调用
+            /// 在 table 的 header 中登记 watchers, 写入者发布后递增 header.signal 并唤醒;
+            /// reactor 用 futex_waitv (Linux 5.16+) 同时等待所有 table 的 signal, 一次最多 128 个, 超出的部分轮询
+            /// 只读映射通过 detail::mmap::shared_header 登记; 文件没有写权限的 table 与不支持 futex_waitv 的平台一样按 1ms 间隔轮询
+            class reactor
+            {
+            public:
+                using size_type = std::size_t;
+
+            private:
+                struct waiter
+                {
+                    bool (*ready)(void *);
+                    void *awaiter;
+                    std::coroutine_handle<> handle;
+                };
+
+                struct watch
+                {
+                    detail::mmap *mmap;
+                    /// 登记 watchers 的可写 header, 地址不随 remmap 变化; nullptr 表示只能轮询
+                    detail::mmap::header *header;
+                    std::uint32_t seen;
+                    std::vector<waiter> waiters;
+                };
+
+                /// futex_waitv 一次可以等待的 futex 数
+                static constexpr size_type max_wait = 128;
+                static constexpr auto poll_interval = std::chrono::milliseconds(1);
+
+                std::vector<watch> watches_;
+
+                static detail::atomic<std::uint32_t> &signal(const watch &w)
+                {
+                    return w.header != nullptr ? w.header->signal : w.mmap->get_header().signal;
+                }
+
+                watch &watch_of(detail::mmap &mmap)
+                {
+                    for (auto &w : watches_)
+                    {
+                        if (w.mmap == &mmap)
+                            return w;
+                    }
+
+                    // 先登记再读取 signal, 之后发布的写入者一定会递增 signal
+                    auto header = mmap.shared_header();
+                    if (header != nullptr)
+                        header->watchers.fetch_add(1);
+                    watches_.push_back({&mmap, header, 0, {}});
+                    watches_.back().seen = signal(watches_.back()).load();
+                    return watches_.back();
+                }
+
+                void unwatch(watch &w)
+                {
+                    if (w.header != nullptr)
+                        w.header->watchers.fetch_sub(1);
+                }
+
+                /// 阻塞到任意 table 的 signal 变化或超时
+                void wait_signals(std::chrono::nanoseconds timeout)
+                {
+                    auto poll = watches_.size() > max_wait;
+#if defined(__linux__) && defined(SYS_futex_waitv) && defined(FUTEX_WAITV_MAX)
+                    struct futex_waitv waiters[max_wait];
+                    unsigned count = 0;
+                    for (auto &w : watches_)
+                    {
+                        if (w.header == nullptr)
+                        {
+                            poll = true;
+                            continue;
+                        }
+                        if (count == max_wait)
+                            continue;
+
+                        // 不带 FUTEX_PRIVATE_FLAG, 与其他进程中写入者的 notify 使用相同的 futex key
+                        waiters[count].val = w.seen;
+                        waiters[count].uaddr = reinterpret_cast<std::uintptr_t>(&signal(w));
+                        waiters[count].flags = FUTEX_32;
+                        waiters[count].__reserved = 0;
+                        ++count;
+                    }
+
+                    if (poll)
+                        timeout = (std::min)(timeout, std::chrono::nanoseconds(poll_interval));
+
+                    if (count != 0)
+                    {
+                        struct timespec deadline;
+                        ::clock_gettime(CLOCK_MONOTONIC, &deadline);
+                        auto ns = deadline.tv_nsec + timeout.count();
+                        deadline.tv_sec += ns / 1000000000;
+                        deadline.tv_nsec = ns % 1000000000;
+
+                        // 返回 EAGAIN (signal 已变化), ETIMEDOUT 或 EINTR 时都由调用者重新检查
+                        if (::syscall(SYS_futex_waitv, waiters, count, 0, &deadline, CLOCK_MONOTONIC) >= 0 || errno != ENOSYS)
+                            return;
+                    }
+#endif
+                    std::this_thread::sleep_for((std::min)(timeout, std::chrono::nanoseconds(poll_interval)));
+                }
+
+            public:
+                reactor() = default;
+                reactor(const reactor &) = delete;
+                reactor &operator=(const reactor &) = delete;
+
+                /// 仍挂起的协程不会被恢复或销毁, 由其所有者负责
+                ~reactor()
+                {
+                    for (auto &w : watches_)
+                        this->unwatch(w);
+                }
+
+                /// 等待 mmap 所属 table 的 ready() 返回 true, 由 table 的 async_until 调用
+                template <typename Ready, typename Resume>
+                awaiter<Ready, Resume> until(detail::mmap &mmap, Ready ready, Resume resume)
+                {
+                    return {*this, mmap, std::move(ready), std::move(resume)};
+                }
+
+                /// 挂起 handle 直到 ready(awaiter) 返回 true, 已就绪时返回 false 不挂起
+                bool suspend(detail::mmap &mmap, bool (*ready)(void *), void *awaiter, std::coroutine_handle<> handle)
+                {
+                    auto &w = this->watch_of(mmap);
+
+                    // 登记之后再检查一次, 与写入者发布后检查 watchers 配对
+                    if (ready(awaiter))
+                    {
+                        if (w.waiters.empty())
+                        {
+                            this->unwatch(w);
+                            watches_.erase(watches_.begin() + (&w - watches_.data()));
+                        }
+                        return false;
+                    }
+
+                    w.waiters.push_back({ready, awaiter, handle});
+                    return true;
+                }
+
+                /// 挂起的协程数
+                size_type pending() const
+                {
+                    size_type count = 0;
+                    for (auto &w : watches_)
+                        count += w.waiters.size();
+                    return count;
+                }
+
+                /// 等待任意 table 发布新数据或超时, 恢复所有已就绪的协程, 返回恢复的个数
+                size_type run_once(std::chrono::nanoseconds timeout = std::chrono::milliseconds(100))
+                {
+                    if (watches_.empty())
+                        return 0;
+
+                    // 没有登记的 table 的 signal 不会变化, 由 wait_signals 按间隔轮询
+                    auto changed = std::any_of(watches_.begin(), watches_.end(), [](const watch &w)
+                                               { return w.header != nullptr && signal(w).load(boost::memory_order_acquire) != w.seen; });
+                    if (!changed)
+                        this->wait_signals(timeout);
+
+                    // 先收集再恢复, 恢复的协程可能再次挂起到 reactor
+                    std::vector<std::coroutine_handle<>> handles;
+                    for (auto &w : watches_)
+                    {
+                        auto seen = signal(w).load(boost::memory_order_acquire);
+                        if (w.header != nullptr && seen == w.seen)
+                            continue;
+                        w.seen = seen;
+
+                        auto it = std::remove_if(w.waiters.begin(), w.waiters.end(), [&handles](const waiter &val)
+                                                 {
+                            if (!val.ready(val.awaiter))
+                                return false;
+                            handles.push_back(val.handle);
+                            return true; });
+                        w.waiters.erase(it, w.waiters.end());
+                    }
+
+                    // 没有等待者的 table 取消登记, 写入者不再为其唤醒
+                    for (auto it = watches_.begin(); it != watches_.end();)
+                    {
+                        if (it->waiters.empty())
+                        {
+                            this->unwatch(*it);
+                            it = watches_.erase(it);
+                        }
+                        else
+                            ++it;
+                    }
+
+                    for (auto handle : handles)
+                        handle.resume();
+                    return handles.size();
+                }
+
+                /// 运行直到没有挂起的协程
+                void run()
+                {
+                    while (this->pending() != 0)
+                        this->run_once();
+                }
+            };
+
+            template <typename Ready, typename Resume>
+            bool awaiter<Ready, Resume>::await_suspend(std::coroutine_handle<> handle)
+            {
+                return reactor_.suspend(mmap_, &awaiter::check, this, handle);
+            }
+        }
+    }
+}
\ No newline at end of file
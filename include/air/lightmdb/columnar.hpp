@@ -0,0 +1,425 @@
+#pragma once
+
+#include <string_view>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "air/lightmdb/core.hpp"
+#include "air/lightmdb/simd.hpp"
+
+namespace air
+{
+    namespace lightmdb
+    {
+        namespace detail
+        {
+            template <typename M>
+            struct member_pointer;
+
+            template <typename C, typename F>
+            struct member_pointer<F C::*>
+            {
+                using class_type = C;
+                using value_type = F;
+            };
+        }
+
+        /// 列式存储: 聚合类型 T 的每个字段保存在独立的连续文件中, 按字段批量扫描时只读取该字段
+        namespace columnar
+        {
+            /// 按 Fields (T 的数据成员指针) 把 T 拆成多列的定长 table, 多写入者, 扩容加锁
+            /// name 为发布状态文件 (每行 1 字节), 第 i 个字段保存在 name + "f" + i 文件中
+            /// 行只有在所有字段写入后才发布, 批量运算只作用于连续已发布的行 (committed 之前)
+            /// 未列出的成员不保存, operator[] 组装的行中这些成员为值初始化的结果
+            template <typename T, auto... Fields>
+            class table
+            {
+            public:
+                using value_type = T;
+                using size_type = std::size_t;
+                using difference_type = std::ptrdiff_t;
+
+                static_assert(sizeof...(Fields) != 0, "columnar table requires at least one field");
+                static_assert(std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>, "columnar table requires trivially copyable and default constructible type");
+                static_assert((std::is_same_v<typename detail::member_pointer<decltype(Fields)>::class_type, T> && ...), "fields must be data members of T");
+
+                /// 字段 Field 的类型
+                template <auto Field>
+                using field_type = typename detail::member_pointer<decltype(Field)>::value_type;
+
+            private:
+                /// 0 表示未发布, 1 表示已发布
+                using state = detail::atomic<std::uint8_t>;
+
+                static constexpr size_type columns = sizeof...(Fields);
+
+                /// 字段 Field 在 Fields 中的位置
+                template <auto Field>
+                static constexpr size_type column_index()
+                {
+                    constexpr std::array<bool, columns> matches = {[]()
+                                                                   {
+                                                                       if constexpr (std::is_same_v<decltype(Field), decltype(Fields)>)
+                                                                           return Field == Fields;
+                                                                       else
+                                                                           return false;
+                                                                   }()...};
+                    size_type index = 0;
+                    while (index < columns && !matches[index])
+                        ++index;
+                    return index;
+                }
+
+                static constexpr std::array<size_type, columns> field_sizes = {sizeof(field_type<Fields>)...};
+
+                // 列在发布状态之后创建, 在它之前声明, 保证发布状态的刷盘与预取线程先停止
+                std::array<std::unique_ptr<detail::mmap>, columns> columns_;
+                // 发布状态, header.lock 为扩容锁, header.size 为已占用的行数, header.committed 为连续已发布的行数
+                detail::mmap state_;
+
+                // 本地 capacity (行数)
+                size_type capacity_;
+
+                static std::string column_name(std::string_view name, size_type index)
+                {
+                    return std::string(name) + "f" + std::to_string(index);
+                }
+
+                /// 列式 table 的所有文件同步翻倍扩容, 不支持分段存储与后台扩容
+                static const options &check(const options &opts)
+                {
+                    if (opts.segment != 0)
+                        throw std::runtime_error("columnar table does not support segment");
+                    if (opts.growth_threshold != 0 || opts.growth_step != 0)
+                        throw std::runtime_error("columnar table does not support growth options");
+
+                    return opts;
+                }
+
+                /// 各列的 header.size 与水位不随写入移动, 不开启自己的刷盘与预取线程
+                /// 由发布状态的线程按已发布的行数一并刷盘与预取各列, 见 detail::mmap::attach
+                static options column_options(const options &opts)
+                {
+                    auto column = opts;
+                    column.prefault = 0;
+                    column.durability = durability_t::none;
+                    return column;
+                }
+
+                void attach()
+                {
+                    for (size_type i = 0; i < columns; ++i)
+                        state_.attach(*columns_[i], field_sizes[i] / sizeof(state));
+                }
+
+                state &at(size_type index)
+                {
+                    return *state_.template at<state>(index);
+                }
+
+                template <size_type I>
+                auto *data()
+                {
+                    using F = field_type<std::get<I>(std::make_tuple(Fields...))>;
+                    return static_cast<F *>(columns_[I]->get_address());
+                }
+
+                template <auto Field>
+                field_type<Field> *column()
+                {
+                    constexpr auto index = column_index<Field>();
+                    static_assert(index < columns, "field is not a column of this table");
+                    return static_cast<field_type<Field> *>(columns_[index]->get_address());
+                }
+
+                void remmap()
+                {
+                    // 先重建列映射, 发布状态最后扩容, 状态容量可见时列已经扩好
+                    capacity_ = state_.get_header().capacity;
+                    for (auto &column : columns_)
+                        column->remmap();
+                    state_.remmap();
+                }
+
+                /// 保证本地映射至少容纳 count 行, 必要时扩容; 列先扩容, 发布状态最后扩容
+                void do_recapacity(size_type count)
+                {
+                    state_.reserve_until(
+                        count * sizeof(state), true, [this]()
+                        { return capacity_ * sizeof(state); },
+                        [this]()
+                        { this->remmap(); },
+                        [this]()
+                        {
+                            for (auto &column : columns_)
+                                column->recapacity();
+                            state_.recapacity(); });
+                }
+
+                /// 保证本地映射至少容纳 count 行, 等待写入者扩容
+                void do_reserve(size_type count)
+                {
+                    while (count > capacity_)
+                    {
+                        auto &header = state_.get_header();
+                        if (header.capacity == capacity_)
+                            state_.count(&detail::stats::capacity_waits);
+                        header.capacity.wait(capacity_);
+
+                        this->remmap();
+                    }
+                }
+
+                template <size_type... I>
+                void do_store(size_type index, const value_type &val, std::index_sequence<I...>)
+                {
+                    ((this->template data<I>()[index] = val.*Fields), ...);
+                }
+
+                template <size_type... I>
+                void do_load(size_type index, value_type &val, std::index_sequence<I...>)
+                {
+                    ((val.*Fields = this->template data<I>()[index]), ...);
+                }
+
+                /// 只有发布位置恰好是水位的写入者负责推进水位, 推进后重新检查水位处的位置
+                void do_advance(size_type index)
+                {
+                    auto begin = state_.get_header().committed.load(boost::memory_order_relaxed);
+                    if (begin != index)
+                        return;
+
+                    for (;;)
+                    {
+                        // 推进范围可能超出本地映射, 其他写入者已经扩容时重建映射
+                        auto end = begin;
+                        for (;; ++end)
+                        {
+                            if (end >= capacity_)
+                            {
+                                if (end >= state_.get_header().capacity)
+                                    break;
+                                this->remmap();
+                            }
+                            if (this->at(end).load(boost::memory_order_acquire) == 0)
+                                break;
+                        }
+                        if (end == begin)
+                            return;
+
+                        auto expected = begin;
+                        if (!state_.get_header().committed.compare_exchange_strong(expected, end))
+                            return;
+
+                        boost::atomic_thread_fence(boost::memory_order_seq_cst);
+                        begin = end;
+                    }
+                }
+
+                /// [first, last) 与已发布的行取交集, 并保证本地映射覆盖这些行
+                std::pair<size_type, size_type> do_range(size_type first, size_type last)
+                {
+                    last = (std::min)(last, this->committed());
+                    first = (std::min)(first, last);
+                    this->do_reserve(last);
+                    return {first, last};
+                }
+
+            public:
+                table(std::string_view name, mode_t mode, size_type capacity, const options &opts = {})
+                    : state_(name, mode, (std::max)(capacity, size_type(1)) * sizeof(state), check(opts), sizeof(state), detail::published_t::committed)
+                {
+                    capacity_ = state_.capacity() / sizeof(state);
+                    for (size_type i = 0; i < columns; ++i)
+                        columns_[i] = std::make_unique<detail::mmap>(column_name(name, i), mode, capacity_ * field_sizes[i], column_options(opts), field_sizes[i]);
+                    this->attach();
+                }
+
+                table(std::string_view name, mode_t mode, const options &opts = {})
+                    : state_(name, mode, check(opts), detail::published_t::committed)
+                {
+                    capacity_ = state_.capacity() / sizeof(state);
+                    for (size_type i = 0; i < columns; ++i)
+                        columns_[i] = std::make_unique<detail::mmap>(column_name(name, i), mode, column_options(opts));
+                    this->attach();
+                }
+
+                size_type push(const value_type &val)
+                {
+                    auto index = state_.get_header().size.fetch_add(1);
+                    this->do_recapacity(index + 1);
+
+                    this->do_store(index, val, std::make_index_sequence<columns>{});
+                    this->at(index).store(1, boost::memory_order_release);
+
+                    boost::atomic_thread_fence(boost::memory_order_seq_cst);
+                    this->do_advance(index);
+                    // 唤醒等待水位的刷盘线程, 没有登记的 watcher 时不写 header
+                    state_.notify();
+
+                    state_.count(&detail::stats::pushes);
+                    state_.count(&detail::stats::bytes, sizeof(value_type));
+                    return index;
+                }
+
+                /// 从各列组装第 index 行, 调用者保证该行已发布
+                value_type operator[](size_type index) const
+                {
+                    auto self = const_cast<table *>(this);
+                    self->do_reserve(index + 1);
+
+                    value_type val{};
+                    self->do_load(index, val, std::make_index_sequence<columns>{});
+                    return val;
+                }
+
+                /// 第 index 行的字段 Field, 只读取该列
+                template <auto Field>
+                field_type<Field> get(size_type index) const
+                {
+                    auto self = const_cast<table *>(this);
+                    self->do_reserve(index + 1);
+                    return self->template column<Field>()[index];
+                }
+
+                bool has_value(size_type index) const
+                {
+                    if (index < this->committed())
+                        return true;
+
+                    auto self = const_cast<table *>(this);
+                    if (index >= self->capacity_)
+                    {
+                        if (index >= self->state_.get_header().capacity)
+                            return false;
+
+                        self->remmap();
+                    }
+                    return self->at(index).load(boost::memory_order_acquire) != 0;
+                }
+
+                /// 已发布行 [first, last) 中字段 Field 的和, 整数扩展到 64 位, 浮点为 double
+                template <auto Field>
+                detail::simd::sum_t<field_type<Field>> sum(size_type first, size_type last) const
+                {
+                    auto self = const_cast<table *>(this);
+                    auto range = self->do_range(first, last);
+                    return detail::simd::sum(self->template column<Field>() + range.first, range.second - range.first);
+                }
+
+                /// 已发布行 [first, last) 中字段 Field 的最小值, 范围为空时为空
+                template <auto Field>
+                std::optional<field_type<Field>> min(size_type first, size_type last) const
+                {
+                    auto self = const_cast<table *>(this);
+                    auto range = self->do_range(first, last);
+                    if (range.first == range.second)
+                        return std::nullopt;
+                    return detail::simd::min(self->template column<Field>() + range.first, range.second - range.first);
+                }
+
+                template <auto Field>
+                std::optional<field_type<Field>> max(size_type first, size_type last) const
+                {
+                    auto self = const_cast<table *>(this);
+                    auto range = self->do_range(first, last);
+                    if (range.first == range.second)
+                        return std::nullopt;
+                    return detail::simd::max(self->template column<Field>() + range.first, range.second - range.first);
+                }
+
+                /// 已发布行 [first, last) 中满足 field op value 的行数
+                template <auto Field>
+                size_type count(size_type first, size_type last, compare_t op, const field_type<Field> &value) const
+                {
+                    auto self = const_cast<table *>(this);
+                    auto range = self->do_range(first, last);
+                    auto data = self->template column<Field>() + range.first;
+                    return detail::simd::dispatch(op, [&](auto compare)
+                                          { return detail::simd::count<decltype(compare)::value>(data, range.second - range.first, value); });
+                }
+
+                /// 对已发布行 [first, last) 中满足 field op value 的行按下标顺序调用 func(index)
+                template <auto Field, typename Func>
+                void scan(size_type first, size_type last, compare_t op, const field_type<Field> &value, Func &&func) const
+                {
+                    auto self = const_cast<table *>(this);
+                    auto range = self->do_range(first, last);
+                    auto data = self->template column<Field>() + range.first;
+                    auto emit = [&](size_type i)
+                    { func(range.first + i); };
+                    detail::simd::dispatch(op, [&](auto compare)
+                                   { detail::simd::scan<decltype(compare)::value>(data, range.second - range.first, value, emit); });
+                }
+
+                /// 对已发布行 [first, last) 中满足 pred(field) 的行按下标顺序调用 func(index), 逐行判断
+                template <auto Field, typename Pred, typename Func>
+                void scan(size_type first, size_type last, Pred &&pred, Func &&func) const
+                {
+                    auto self = const_cast<table *>(this);
+                    auto range = self->do_range(first, last);
+                    auto data = self->template column<Field>();
+                    for (auto i = range.first; i < range.second; ++i)
+                    {
+                        if (pred(data[i]))
+                            func(i);
+                    }
+                }
+
+                /// 保证调用前发布的行 (所有列) 都已刷盘, 见 options::durability
+                void sync()
+                {
+                    state_.sync();
+                }
+
+                /// 已刷盘的行数, 这些行的发布状态与所有列都已落盘
+                size_type durable_size() const
+                {
+                    return state_.durable_size() / sizeof(state);
+                }
+
+                bool empty() const
+                {
+                    return !this->size();
+                }
+
+                /// 已占用的行数, 其中可能有尚未发布的行
+                size_type size() const
+                {
+                    return state_.size();
+                }
+
+                /// 连续已发布的行数, 批量运算只读取这之前的行
+                size_type committed() const
+                {
+                    return const_cast<table *>(this)->state_.get_header().committed.load(boost::memory_order_acquire);
+                }
+
+                size_type max_size() const
+                {
+                    return std::numeric_limits<size_type>::max();
+                }
+
+                size_type capacity() const
+                {
+                    return state_.capacity() / sizeof(state);
+                }
+
+                const std::string &name() const
+                {
+                    return state_.name();
+                }
+            };
+        }
+    }
+}
\ No newline at end of file
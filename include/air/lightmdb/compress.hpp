@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace air
+{
+    namespace lightmdb
+    {
+        namespace detail
+        {
+            /// LZ4 块格式 (不含帧头) 的压缩与解压, 用于归档数据块; 只追求解压速度, 压缩使用单项哈希表贪心匹配
+            namespace lz4
+            {
+                /// 最短匹配长度
+                constexpr std::size_t min_match = 4;
+                /// 块末尾必须是字面量的字节数
+                constexpr std::size_t last_literals = 5;
+                /// 最后一个匹配的起点距块末尾至少的字节数
+                constexpr std::size_t match_limit = 12;
+                /// 匹配的最大距离
+                constexpr std::size_t max_distance = 65535;
+                constexpr std::size_t hash_bits = 12;
+
+                /// n 字节数据压缩后的最大字节数
+                constexpr std::size_t compress_bound(std::size_t n)
+                {
+                    return n + n / 255 + 16;
+                }
+
+                /// 写入长度的扩展字节, 调用者已在 token 中写入 15
+                inline char *write_length(char *op, std::size_t len)
+                {
+                    for (; len >= 255; len -= 255)
+                        *op++ = static_cast<char>(255);
+                    *op++ = static_cast<char>(len);
+                    return op;
+                }
+
+                /// 写入一个序列: [anchor, anchor + literals) 的字面量, 之后是距离 offset, 长度 len 的匹配 (len 为 0 时为最后一个序列)
+                inline char *write_sequence(char *op, const char *anchor, std::size_t literals, std::size_t offset, std::size_t len)
+                {
+                    auto token = op++;
+                    *token = static_cast<char>((literals < 15 ? literals : 15) << 4);
+                    if (literals >= 15)
+                        op = write_length(op, literals - 15);
+                    memcpy(op, anchor, literals);
+                    op += literals;
+
+                    if (len == 0)
+                        return op;
+
+                    *op++ = static_cast<char>(offset & 0xff);
+                    *op++ = static_cast<char>(offset >> 8);
+                    len -= min_match;
+                    *token = static_cast<char>(*token | (len < 15 ? len : 15));
+                    if (len >= 15)
+                        op = write_length(op, len - 15);
+                    return op;
+                }
+
+                /// 压缩 src 的 n 字节到 dst, dst 至少 compress_bound(n) 字节, 返回压缩后的字节数
+                inline std::size_t compress(const char *src, std::size_t n, char *dst)
+                {
+                    auto table = std::make_unique<std::uint32_t[]>(std::size_t(1) << hash_bits);
+                    auto op = dst;
+                    std::size_t anchor = 0;
+
+                    if (n > match_limit)
+                    {
+                        for (std::size_t i = 0, limit = n - match_limit; i < limit;)
+                        {
+                            std::uint32_t seq, candidate;
+                            memcpy(&seq, src + i, sizeof(seq));
+                            auto &slot = table[(seq * 2654435761u) >> (32 - hash_bits)];
+                            std::size_t ref = slot;
+                            slot = static_cast<std::uint32_t>(i);
+
+                            if (ref >= i || i - ref > max_distance || (memcpy(&candidate, src + ref, sizeof(candidate)), candidate != seq))
+                            {
+                                ++i;
+                                continue;
+                            }
+
+                            std::size_t len = min_match;
+                            while (i + len < n - last_literals && src[ref + len] == src[i + len])
+                                ++len;
+                            while (i > anchor && ref > 0 && src[i - 1] == src[ref - 1])
+                            {
+                                --i;
+                                --ref;
+                                ++len;
+                            }
+
+                            op = write_sequence(op, src + anchor, i - anchor, i - ref, len);
+                            i += len;
+                            anchor = i;
+                        }
+                    }
+
+                    op = write_sequence(op, src + anchor, n - anchor, 0, 0);
+                    return static_cast<std::size_t>(op - dst);
+                }
+
+                /// 读取长度的扩展字节, 越界时返回 false
+                inline bool read_length(const char *&ip, const char *end, std::size_t &len)
+                {
+                    for (;;)
+                    {
+                        if (ip == end)
+                            return false;
+                        auto byte = static_cast<unsigned char>(*ip++);
+                        len += byte;
+                        if (byte != 255)
+                            return true;
+                    }
+                }
+
+                /// 解压 src 的 n 字节到 dst, 解压后必须恰好为 raw 字节; 数据损坏时返回 false, 不会越界读写
+                inline bool decompress(const char *src, std::size_t n, char *dst, std::size_t raw)
+                {
+                    auto ip = src, end = src + n;
+                    auto op = dst, limit = dst + raw;
+
+                    while (ip < end)
+                    {
+                        auto token = static_cast<unsigned char>(*ip++);
+                        std::size_t literals = token >> 4;
+                        if (literals == 15 && !read_length(ip, end, literals))
+                            return false;
+                        if (literals > std::size_t(end - ip) || literals > std::size_t(limit - op))
+                            return false;
+                        memcpy(op, ip, literals);
+                        ip += literals;
+                        op += literals;
+
+                        // 最后一个序列没有匹配
+                        if (ip == end)
+                            break;
+
+                        if (end - ip < 2)
+                            return false;
+                        std::size_t offset = static_cast<unsigned char>(ip[0]) | (std::size_t(static_cast<unsigned char>(ip[1])) << 8);
+                        ip += 2;
+                        if (offset == 0 || offset > std::size_t(op - dst))
+                            return false;
+
+                        std::size_t len = token & 15;
+                        if (len == 15 && !read_length(ip, end, len))
+                            return false;
+                        len += min_match;
+                        if (len > std::size_t(limit - op))
+                            return false;
+
+                        // 距离小于长度时匹配与输出重叠, 逐字节复制
+                        auto from = op - offset;
+                        if (offset >= len)
+                            memcpy(op, from, len);
+                        else
+                        {
+                            for (std::size_t i = 0; i < len; ++i)
+                                op[i] = from[i];
+                        }
+                        op += len;
+                    }
+                    return op == limit;
+                }
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <string_view>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "air/lightmdb/core.hpp"
+
+namespace air
+{
+    namespace lightmdb
+    {
+        /// 消费者位置: 每个具名消费者提交自己已处理到的位置, 保存在 table 旁的 name + "c" 文件中
+        /// 读者重启后用 fetch 取回位置继续读取, 保留策略与背压用 min_committed_offset 得到最慢消费者的位置
+        /// 位置的含义由使用者决定, 通常为 cursor::position
+        namespace consumer
+        {
+            class offsets
+            {
+            public:
+                using size_type = std::size_t;
+
+                /// 消费者名字的最大长度
+                static constexpr size_type max_name = 47;
+
+            private:
+                /// 每个消费者占一个缓存行, 提交位置时不与其他消费者伪共享
+                struct alignas(detail::cache_line) slot
+                {
+                    /// 0 表示空闲, 1 表示已被消费者占用
+                    detail::atomic<std::uint32_t> used;
+                    char name[max_name + 1];
+                    detail::atomic<std::uint64_t> offset;
+                };
+
+                // header.size 为曾经占用过的槽位数, 扫描只需到这里; 可恢复锁 (mmap::lock_owner) 保护 join 与 leave
+                // join 先写槽位再发布 used, 最后推进 header.size, 持锁进程崩溃后留下的状态都可以继续使用
+                detail::mmap mmap_;
+                size_type capacity_;
+
+                static std::string file_name(std::string_view name)
+                {
+                    return std::string(name) + "c";
+                }
+
+                slot &at(size_type index)
+                {
+                    return *mmap_.template at<slot>(index);
+                }
+
+                size_type slots() const
+                {
+                    return (std::min)(mmap_.size(), capacity_);
+                }
+
+                void check_writable() const
+                {
+                    if (!mmap_.writable())
+                        throw std::runtime_error("consumer offsets require a writable mapping " + mmap_.name());
+                }
+
+                void lock()
+                {
+                    mmap_.lock_owner();
+                }
+
+                void unlock()
+                {
+                    mmap_.unlock_owner();
+                }
+
+            public:
+                /// slots 为最多同时存在的消费者数
+                offsets(std::string_view name, mode_t mode, size_type slots, const options &opts = {})
+                    : mmap_(file_name(name), mode, slots * sizeof(slot), opts, sizeof(slot))
+                {
+                    capacity_ = mmap_.capacity() / sizeof(slot);
+                }
+
+                offsets(std::string_view name, mode_t mode, const options &opts = {})
+                    : mmap_(file_name(name), mode, opts)
+                {
+                    capacity_ = mmap_.capacity() / sizeof(slot);
+                }
+
+                /// 查找消费者的槽位, 不存在时返回 capacity()
+                size_type find(std::string_view consumer) const
+                {
+                    auto self = const_cast<offsets *>(this);
+                    for (size_type i = 0, count = this->slots(); i < count; ++i)
+                    {
+                        auto &s = self->at(i);
+                        if (s.used.load(boost::memory_order_acquire) != 0 && consumer == s.name)
+                            return i;
+                    }
+                    return capacity_;
+                }
+
+                /// 登记消费者并返回其槽位, 已存在时直接返回; 新消费者的位置为 offset
+                /// 之后用槽位提交位置, 不再按名字查找
+                size_type join(std::string_view consumer, size_type offset = 0)
+                {
+                    check_writable();
+                    if (consumer.empty() || consumer.size() > max_name)
+                        throw std::runtime_error("invalid consumer name " + std::string(consumer));
+
+                    this->lock();
+                    auto index = this->find(consumer);
+                    if (index == capacity_)
+                    {
+                        auto &header = mmap_.get_header();
+                        auto count = this->slots();
+                        for (index = 0; index < count && this->at(index).used.load() != 0; ++index)
+                            ;
+                        if (index == capacity_)
+                        {
+                            this->unlock();
+                            throw std::runtime_error("too many consumers " + mmap_.name());
+                        }
+
+                        // 崩溃的 join 可能已发布 used 而未推进 header.size, 覆盖前先撤销
+                        auto &s = this->at(index);
+                        s.used.store(0, boost::memory_order_relaxed);
+                        memset(s.name, 0, sizeof(s.name));
+                        memcpy(s.name, consumer.data(), consumer.size());
+                        s.offset.store(offset, boost::memory_order_relaxed);
+                        s.used.store(1, boost::memory_order_release);
+                        if (index == count)
+                            header.size = count + 1;
+                    }
+                    this->unlock();
+                    return index;
+                }
+
+                /// 注销消费者, 之后它不再影响 min_committed_offset
+                bool leave(std::string_view consumer)
+                {
+                    check_writable();
+                    this->lock();
+                    auto index = this->find(consumer);
+                    if (index != capacity_)
+                        this->at(index).used.store(0, boost::memory_order_release);
+                    this->unlock();
+                    return index != capacity_;
+                }
+
+                /// 提交槽位 index 的消费者已处理到的位置
+                void commit(size_type index, size_type offset)
+                {
+                    check_writable();
+                    this->at(index).offset.store(offset, boost::memory_order_release);
+                }
+
+                /// 按名字提交, 消费者不存在时先登记
+                void commit(std::string_view consumer, size_type offset)
+                {
+                    this->commit(this->join(consumer, offset), offset);
+                }
+
+                /// 消费者上次提交的位置, 未登记时为空
+                std::optional<size_type> fetch(std::string_view consumer) const
+                {
+                    auto index = this->find(consumer);
+                    if (index == capacity_)
+                        return std::nullopt;
+                    return this->fetch(index);
+                }
+
+                size_type fetch(size_type index) const
+                {
+                    return const_cast<offsets *>(this)->at(index).offset.load(boost::memory_order_acquire);
+                }
+
+                /// 所有消费者中最小的已提交位置, 之前的数据已被所有消费者处理; 没有消费者时为空
+                /// 只扫描曾经占用过的槽位, 每个消费者一个缓存行
+                std::optional<size_type> min_committed_offset() const
+                {
+                    auto self = const_cast<offsets *>(this);
+                    auto min = std::numeric_limits<size_type>::max();
+                    auto found = false;
+                    for (size_type i = 0, count = this->slots(); i < count; ++i)
+                    {
+                        auto &s = self->at(i);
+                        if (s.used.load(boost::memory_order_acquire) == 0)
+                            continue;
+                        min = (std::min)(min, static_cast<size_type>(s.offset.load(boost::memory_order_acquire)));
+                        found = true;
+                    }
+                    if (!found)
+                        return std::nullopt;
+                    return min;
+                }
+
+                /// 对每个已登记的消费者调用 func(name, offset), 用于监控消费延迟
+                template <typename Func>
+                void for_each(Func &&func) const
+                {
+                    auto self = const_cast<offsets *>(this);
+                    for (size_type i = 0, count = this->slots(); i < count; ++i)
+                    {
+                        auto &s = self->at(i);
+                        if (s.used.load(boost::memory_order_acquire) != 0)
+                            func(std::string_view(s.name), static_cast<size_type>(s.offset.load(boost::memory_order_acquire)));
+                    }
+                }
+
+                /// 最多同时存在的消费者数
+                size_type capacity() const
+                {
+                    return capacity_;
+                }
+
+                const std::string &name() const
+                {
+                    return mmap_.name();
+                }
+            };
+        }
+    }
+}
\ No newline at end of file
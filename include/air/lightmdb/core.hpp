@@ -8,8 +8,37 @@
 #include <stdexcept>
 #include <climits>
 #include <limits>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <initializer_list>
+#include <map>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <signal.h>
+#include <cerrno>
+#include <ctime>
+#endif
 
 #include <boost/atomic/ipc_atomic.hpp>
+#include <boost/atomic/fences.hpp>
 #include <boost/interprocess/offset_ptr.hpp>
 #include <boost/interprocess/managed_mapped_file.hpp>
 #include <boost/interprocess/managed_shared_memory.hpp>
@@ -28,96 +57,1167 @@ namespace air
             copy_on_write
         };
 
+        /// 写入者模型
+        enum class producer_t : int8_t
+        {
+            /// 多个线程/进程同时写入
+            multi = 0,
+            /// 只有一个写入者, 写入位置保存在本地, push 路径没有原子 RMW
+            single
+        };
+
+        /// madvise 提示
+        enum class advice_t : int8_t
+        {
+            normal = 0,
+            sequential,
+            random,
+            willneed,
+            dontneed
+        };
+
+        /// 持久化策略
+        enum class durability_t : int8_t
+        {
+            /// 不主动刷盘, 由操作系统回写; 只有显式调用 sync 时刷盘
+            none = 0,
+            /// 后台线程每 sync_interval 毫秒, 或未刷盘数据达到 sync_bytes 字节时刷盘
+            periodic,
+            /// 后台线程在有未刷盘数据或 sync 请求时立即刷盘, 刷盘期间到达的请求合并到下一次
+            group_commit
+        };
+
+        /// 存储后端, 三种后端的扩容语义相同, table 的文件名在 shm/memfd 下为后端内的名字
+        enum class backend_t : int8_t
+        {
+            /// 普通文件
+            file = 0,
+            /// POSIX 共享内存 (仅 Linux, 位于 /dev/shm), 不经过数据盘回写, 重启后消失
+            shm,
+            /// 匿名 memfd (仅 Linux), 名字只在进程内的登记表中有效
+            /// fork 的子进程继承登记表与描述符; 其他进程用 SCM_RIGHTS 收到描述符后通过 memfd_register 登记
+            /// 不支持分段存储: 扩容时新建的段只登记在扩容的进程中
+            memfd
+        };
+
+        namespace detail
+        {
+            /// 默认存储后端, 定义 AIR_LIGHTMDB_BACKEND 为 file/shm/memfd 时使用对应后端
+#if defined(AIR_LIGHTMDB_BACKEND)
+            constexpr backend_t default_backend = backend_t::AIR_LIGHTMDB_BACKEND;
+#else
+            constexpr backend_t default_backend = backend_t::file;
+#endif
+        }
+
+        /// 打开 table 时的可选参数
+        struct options
+        {
+            /// 分段存储时每段容纳的元素个数, 必须是 2 的幂; 0 表示单文件连续存储
+            /// 分段存储扩容时只追加新段文件, 已有映射和指针保持有效
+            std::size_t segment = 0;
+
+            /// 预留的虚拟地址空间字节数 (仅 Linux, 不能与 segment 同时使用), 0 表示不预留
+            /// 扩容时只把新增部分映射进预留区间, 基地址不变, remmap 不再重建映射
+            std::size_t reserve = 0;
+
+            /// 后台线程在写入位置 (header.size) 之前预先缺页的字节数 (仅 Linux, 可写映射), 0 表示关闭
+            std::size_t prefault = 0;
+
+            /// header.size 达到 capacity 的该比例 (0, 1] 时由后台线程持有 header.lock 提前扩容 (仅可写映射), 0 表示关闭
+            /// 写入者越过本地 capacity 时通常只需 remmap, 不再等待文件扩展; 要求 table 的写入者扩容时加锁 (IsLock 且多写入者)
+            double growth_threshold = 0;
+
+            /// 连续存储每次扩容增加的字节数 (向上取整到元素大小), 文件大小线性增长; 0 表示容量翻倍
+            /// 分段存储每次追加一段, 忽略该参数
+            std::size_t growth_step = 0;
+
+            /// 对映射使用透明大页 (MADV_HUGEPAGE), 适合位于 /dev/shm 的 table
+            /// 位于 hugetlbfs 上的文件由内核直接使用大页, 此时 capacity 应为大页大小的整数倍
+            bool huge_pages = false;
+
+            /// 每次映射后对映射区调用的 madvise 提示; dontneed 不作用于新映射, 只用于 table 的 advise
+            advice_t advice = advice_t::normal;
+
+            /// 存储后端, 同一个 table 的所有进程必须使用相同的后端
+            backend_t backend = detail::default_backend;
+
+            /// 持久化策略 (仅 Linux, 可写映射), 刷盘线程推进 header.durable_size, 不参与写入路径
+            durability_t durability = durability_t::none;
+
+            /// periodic 的刷盘间隔 (毫秒)
+            std::size_t sync_interval = 10;
+
+            /// periodic 下未刷盘数据达到该字节数时提前刷盘, 0 表示只按时间刷盘
+            std::size_t sync_bytes = 0;
+
+            /// 可写映射打开时执行崩溃恢复: 从连续已发布水位扫描到 size, 把未发布的位置标记为跳过
+            /// 只能在没有其他写入者时使用 (例如写入者崩溃后重启)
+            bool recover = false;
+        };
+
         namespace detail
         {
             template <typename T>
             using atomic = boost::ipc_atomic<T>;
 
+            /// locked 为 false 的 table 由唯一的写入者不加锁扩容, 不能与后台扩容线程并发
+            inline const options &check_growth(const options &opts, bool locked)
+            {
+                if (opts.growth_threshold < 0 || opts.growth_threshold > 1)
+                    throw std::runtime_error("growth_threshold must be in [0, 1]");
+                if (opts.growth_threshold != 0 && !locked)
+                    throw std::runtime_error("background growth requires a locking multi-producer table");
+
+                return opts;
+            }
+
+            /// 刷盘线程推进 durable_size 所用的已发布水位, 由 table 按写入方式选择
+            enum class published_t : int8_t
+            {
+                /// header.size 在数据写完之后才推进
+                size = 0,
+                /// 先占用再写入, table 维护连续已发布的 header.committed
+                committed,
+                /// 多写入者先占用再写入, 数据区没有按位置的发布标志, 写入者用 mmap::enter/leave 登记, 见 mmap::publish
+                epoch
+            };
+
+            /// 缓存行大小
+            constexpr std::size_t cache_line = 64;
+
+            /// 单写入者模式下每写入多少条数据发布一次 header.size
+            constexpr std::size_t flush_interval = 64;
+
+            /// 是否更新 header 中的统计计数器, 定义 AIR_LIGHTMDB_STATS 时启用
+#if defined(AIR_LIGHTMDB_STATS)
+            constexpr bool stats_enabled = true;
+#else
+            constexpr bool stats_enabled = false;
+#endif
+
+            /// 热路径统计计数器, 位于 header 中, 文件格式与是否启用统计无关
+            /// 只有启用统计且映射可写 (read_write) 的进程会更新, 未启用时所有计数操作在编译期消除
+            struct alignas(cache_line) stats
+            {
+                /// push 的数据条数与字节数
+                detail::atomic<std::uint64_t> pushes;
+                detail::atomic<std::uint64_t> bytes;
+                /// 扩容次数与耗时 (ns)
+                detail::atomic<std::uint64_t> recapacity;
+                detail::atomic<std::uint64_t> recapacity_ns;
+                /// 重新映射次数与耗时 (ns)
+                detail::atomic<std::uint64_t> remmap;
+                detail::atomic<std::uint64_t> remmap_ns;
+                /// 扩容时抢锁失败, 等待其他写入者扩容的次数
+                detail::atomic<std::uint64_t> lock_spins;
+                /// 读取位置超出本地 capacity, 等待扩容的次数
+                detail::atomic<std::uint64_t> capacity_waits;
+                /// 读者进入阻塞等待与被唤醒返回的次数
+                detail::atomic<std::uint64_t> waits;
+                detail::atomic<std::uint64_t> wakeups;
+                /// 写入者调用 notify 的次数
+                detail::atomic<std::uint64_t> notifies;
+
+                void clear()
+                {
+                    for (auto counter : {&stats::pushes, &stats::bytes, &stats::recapacity, &stats::recapacity_ns, &stats::remmap, &stats::remmap_ns,
+                                         &stats::lock_spins, &stats::capacity_waits, &stats::waits, &stats::wakeups, &stats::notifies})
+                        (this->*counter).store(0, boost::memory_order_relaxed);
+                }
+            };
+
+            /// 统计用的时间戳 (ns), 未启用统计时为 0
+            inline std::uint64_t stats_now()
+            {
+                if constexpr (stats_enabled)
+                    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+                return 0;
+            }
+
+            /// 自旋等待时的 CPU 提示
+            inline void pause()
+            {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+                _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+                __asm__ __volatile__("yield");
+#endif
+            }
+
+            /// 轮询直到 ready 返回 true, 先自旋再让出时间片
+            /// 用于无法打开可写 header 视图或平台没有原生 futex 时的阻塞等待, 以及 busy_spin 等待策略
+            template <typename Ready>
+            void poll_wait(Ready &&ready)
+            {
+                for (std::size_t i = 0; !ready(); ++i)
+                {
+                    if (i < 1024)
+                        pause();
+                    else
+                        std::this_thread::yield();
+                }
+            }
+
+            /// word 仍等于 val 时阻塞, timeout 为 0 时不超时; 被唤醒, 超时或被信号中断时都返回, 由调用者重新检查
+            /// 用于需要超时的等待 (boost 的 wait 没有超时), 不带 FUTEX_PRIVATE_FLAG, 可以被其他进程的 notify 唤醒
+            inline void timed_wait(detail::atomic<std::uint32_t> &word, std::uint32_t val, std::chrono::nanoseconds timeout)
+            {
+#if defined(__linux__)
+                struct timespec ts;
+                ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+                ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+                ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAIT, val, timeout.count() != 0 ? &ts : nullptr, nullptr, 0);
+#else
+                if (word.load() == val)
+                    std::this_thread::sleep_for(timeout.count() != 0 ? timeout : std::chrono::nanoseconds(1000000));
+#endif
+            }
+
+            /// 当前进程的 pid, 用于 mmap::lock_owner
+            inline std::uint32_t process_id()
+            {
+#if defined(__linux__)
+                return static_cast<std::uint32_t>(::getpid());
+#else
+                return 1;
+#endif
+            }
+
+            /// pid 对应的进程是否仍存在 (同一 pid 命名空间), 无法判断的平台总是返回 true
+            inline bool process_alive(std::uint32_t pid)
+            {
+#if defined(__linux__)
+                return ::kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+#else
+                (void)pid;
+                return true;
+#endif
+            }
+
+            /// memfd 登记表, 名字到描述符; 描述符在 memfd_remove 之前一直保持打开
+            struct memfd_registry
+            {
+                std::mutex mutex;
+                std::map<std::string, int, std::less<>> fds;
+            };
+
+            inline memfd_registry &memfds()
+            {
+                static memfd_registry registry;
+                return registry;
+            }
+
+            /// 把后端内的名字解析为可以 open/truncate 的路径, create 为 true 时 memfd 后端创建新的 memfd
+            inline std::string backend_path(std::string_view name, backend_t backend, bool create)
+            {
+                switch (backend)
+                {
+                case backend_t::shm:
+                {
+#if defined(__linux__)
+                    // 与 shm_open 相同, 名字中的目录分隔符不能出现在 /dev/shm 下
+                    std::string path(name);
+                    std::replace(path.begin(), path.end(), '/', '_');
+                    return "/dev/shm/" + path;
+#else
+                    throw std::runtime_error("shm backend is only supported on linux");
+#endif
+                }
+                case backend_t::memfd:
+                {
+#if defined(__linux__)
+                    auto &registry = memfds();
+                    std::lock_guard<std::mutex> lock(registry.mutex);
+                    auto it = registry.fds.find(name);
+                    if (create)
+                    {
+                        // 与普通文件的 create_only 相同, 同名的旧 memfd 被替换
+                        auto fd = ::memfd_create(std::string(name).c_str(), MFD_CLOEXEC);
+                        if (fd < 0)
+                            throw std::runtime_error("failed to create memfd " + std::string(name));
+                        if (it != registry.fds.end())
+                        {
+                            ::close(it->second);
+                            it->second = fd;
+                        }
+                        else
+                            registry.fds.emplace(name, fd);
+                        return "/proc/self/fd/" + std::to_string(fd);
+                    }
+
+                    if (it == registry.fds.end())
+                        throw std::runtime_error("memfd not found " + std::string(name));
+                    return "/proc/self/fd/" + std::to_string(it->second);
+#else
+                    throw std::runtime_error("memfd backend is only supported on linux");
+#endif
+                }
+                default:
+                    return std::string(name);
+                }
+            }
+
+            inline bool backend_exists(std::string_view name, backend_t backend)
+            {
+                if (backend == backend_t::memfd)
+                {
+                    auto &registry = memfds();
+                    std::lock_guard<std::mutex> lock(registry.mutex);
+                    return registry.fds.find(name) != registry.fds.end();
+                }
+                return std::filesystem::exists(backend_path(name, backend, false));
+            }
+
+            inline bool backend_remove(std::string_view name, backend_t backend)
+            {
+                if (backend == backend_t::memfd)
+                {
+#if defined(__linux__)
+                    auto &registry = memfds();
+                    std::lock_guard<std::mutex> lock(registry.mutex);
+                    auto it = registry.fds.find(name);
+                    if (it == registry.fds.end())
+                        return false;
+                    ::close(it->second);
+                    registry.fds.erase(it);
+                    return true;
+#else
+                    return false;
+#endif
+                }
+                return std::filesystem::remove(backend_path(name, backend, false));
+            }
+
             class mmap
             {
             public:
                 using size_type = std::size_t;
                 using difference_type = std::ptrdiff_t;
 
-                struct header
+                /// 文件标识 "LMDB" 与格式版本, 打开时检查; 修改 header 布局时递增 format_version
+                /// 没有 magic 的旧文件 (数据区紧跟 24 字节的 header) 需要重新生成
+                static constexpr std::uint32_t format_magic = 0x42444d4c;
+                static constexpr std::uint32_t format_version = 1;
+
+                /// 按缓存行对齐, 保证数据区起点满足 layout 的对齐要求
+                struct alignas(cache_line) header
                 {
+                    std::uint32_t magic;
+                    std::uint32_t version;
                     detail::atomic<size_type> size;
                     detail::atomic<size_type> capacity;
                     detail::atomic<bool> lock;
+                    /// 可恢复锁的持有进程 pid, 0 表示空闲, 见 lock_owner
+                    detail::atomic<std::uint32_t> owner;
+                    /// 在 signal 上阻塞等待的读者数, 与 watchers 都为 0 时写入者发布后不写 signal
+                    detail::atomic<std::uint32_t> waiters;
+                    /// 登记了等待的 async::reactor 数
+                    detail::atomic<std::uint32_t> watchers;
+                    /// 发布计数, 每次发布 (批量发布只算一次) 在有等待者时递增并唤醒; 阻塞的读者与 reactor 都以它为 futex
+                    detail::atomic<std::uint32_t> signal;
+                    /// 连续已发布的数据, 之前的数据都已写完; published_t::committed 由 table 维护, published_t::epoch 由 publish 推进
+                    /// 一般为字节数, columnar::table 的状态文件为行数
+                    detail::atomic<size_type> committed;
+                    /// published_t::epoch: 写入者在 inflight[epoch & 1] 登记, mark[e & 1] 为 epoch 从 e 切换到 e + 1 之前读取的 size
+                    detail::atomic<std::uint32_t> epoch;
+                    detail::atomic<std::uint32_t> inflight[2];
+                    detail::atomic<size_type> mark[2];
+
+                    /// 已刷盘的已发布数据字节数, 只增不减; 随下一次刷盘落盘, 磁盘上的值可能偏小
+                    /// 刷盘前读取已发布水位 (见 published_t), 已占用但尚未写完的数据不计入; 需要确认自己的数据落盘时使用 sync
+                    detail::atomic<size_type> durable_size;
+                    /// sync 请求与已完成的请求序号, completed >= 请求序号时该请求之前写入的数据已刷盘
+                    detail::atomic<std::uint64_t> sync_requested;
+                    detail::atomic<std::uint64_t> sync_completed;
+
+                    /// 已释放的数据区前缀字节数, 之前的数据不能再读取, 见 discard
+                    detail::atomic<size_type> discarded;
+
+                    /// 分段存储目录: 每段容纳 1 << segment_shift 个元素, 0 表示单文件连续存储
+                    size_type segment_shift;
+                    /// 元素大小, 每段大小为 unit << segment_shift 字节
+                    size_type unit;
+
+                    detail::stats stats;
                 };
 
             private:
                 header *header_;
                 std::string mmap_name_;
+                // 主文件在存储后端中的路径
+                std::string path_;
+                boost::interprocess::mode_t file_mapping_mode_;
                 boost::interprocess::mode_t mapped_region_mode_;
                 std::unique_ptr<boost::interprocess::file_mapping> file_mapp_;
                 std::unique_ptr<boost::interprocess::mapped_region> region_;
 
-                void create_file(size_type size)
+                // 分段存储, 第 0 段位于主文件 header 之后, 其余段为 name.1 name.2 ...
+                size_type segment_shift_;
+                size_type segment_mask_;
+                std::vector<char *> segments_;
+                std::vector<boost::interprocess::file_mapping> segment_files_;
+                std::vector<boost::interprocess::mapped_region> segment_regions_;
+
+                // 预留地址空间, reserved_ 为映射起点 (header 所在位置)
+                char *reserved_ = nullptr;
+                size_type reserved_size_ = 0;
+                // 已映射的文件字节数
+                size_type mapped_size_ = 0;
+
+                options options_;
+                published_t published_;
+
+                // 预取线程与 remmap 互斥, 热路径不加锁
+                std::mutex map_mutex_;
+                std::condition_variable prefault_cv_;
+                std::thread prefault_thread_;
+                bool prefault_stop_ = false;
+
+                // 后台扩容线程使用独立的 header 映射, 与写入者通过 header.lock 互斥
+                // 扩容线程空闲时阻塞, 由越过 grow_at_ 的写入者唤醒; 没有扩容线程时 grow_at_ 为最大值
+                std::mutex grow_mutex_;
+                std::condition_variable grow_cv_;
+                std::thread grow_thread_;
+                bool grow_stop_ = false;
+                bool grow_wake_ = false;
+                std::atomic<size_type> grow_at_{std::numeric_limits<size_type>::max()};
+                boost::interprocess::mapped_region grow_region_;
+
+                // 独立的可写 header 映射, 地址不随 remmap 变化; 只读映射通过它登记等待者, 见 shared_header
+                std::once_flag shared_once_;
+                std::unique_ptr<boost::interprocess::file_mapping> shared_file_;
+                boost::interprocess::mapped_region shared_region_;
+                header *shared_header_ = nullptr;
+
+                // 刷盘线程使用独立的 header 映射与文件描述符, 不与 remmap 互斥; 空闲时在 header.signal 上阻塞
+                std::mutex flush_mutex_;
+                std::thread flush_thread_;
+                std::atomic<bool> flush_stop_{false};
+                boost::interprocess::mapped_region flush_region_;
+                // 第 i 个元素为第 i 段文件 (第 0 段为主文件) 的描述符
+                std::vector<int> flush_fds_;
+
+                // 附属映射与换算比例, 见 attach; 预取线程持有 map_mutex_, 刷盘持有 flush_mutex_ 时访问
+                std::vector<std::pair<mmap *, size_type>> attached_;
+
+                static void create_file(const std::string &name, size_type size)
+                {
+                    {
+                        std::filebuf fbuf;
+                        if (nullptr == fbuf.open(name, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary))
+                            throw std::runtime_error("failed to create file " + name);
+                    }
+                    // 用截断代替写入末尾字节, hugetlbfs 不支持 write
+                    std::filesystem::resize_file(name, size);
+                }
+
+#if defined(__linux__)
+                static int to_madvise(advice_t advice)
+                {
+                    switch (advice)
+                    {
+                    case advice_t::sequential:
+                        return MADV_SEQUENTIAL;
+                    case advice_t::random:
+                        return MADV_RANDOM;
+                    case advice_t::willneed:
+                        return MADV_WILLNEED;
+                    case advice_t::dontneed:
+                        return MADV_DONTNEED;
+                    default:
+                        return MADV_NORMAL;
+                    }
+                }
+
+                /// 把 [addr, addr + size) 扩展到页边界
+                static std::pair<char *, size_type> page_align(void *addr, size_type size)
+                {
+                    auto page = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+                    auto begin = reinterpret_cast<std::uintptr_t>(addr) / page * page;
+                    auto end = (reinterpret_cast<std::uintptr_t>(addr) + size + page - 1) / page * page;
+                    return {reinterpret_cast<char *>(begin), static_cast<size_type>(end - begin)};
+                }
+#endif
+
+                /// 对新映射的区域应用大页与 madvise 提示
+                void hint(void *addr, size_type size)
+                {
+#if defined(__linux__)
+                    auto range = page_align(addr, size);
+#if defined(MADV_HUGEPAGE)
+                    if (options_.huge_pages)
+                        ::madvise(range.first, range.second, MADV_HUGEPAGE);
+#endif
+                    // dontneed 会丢弃刚映射 (可能刚预取) 的页面, 只在显式的 advise 中使用
+                    if (options_.advice != advice_t::normal && options_.advice != advice_t::dontneed)
+                        ::madvise(range.first, range.second, to_madvise(options_.advice));
+#endif
+                }
+
+                /// 把数据区 [offset, offset + size) 按已映射的连续地址拆分后依次调用 func(addr, size)
+                template <typename Func>
+                void for_each_range(size_type offset, size_type size, Func &&func)
+                {
+                    auto capacity = this->capacity();
+                    if (offset >= capacity)
+                        return;
+                    size = (std::min)(size, capacity - offset);
+
+                    if (segment_shift_ == 0)
+                    {
+                        func(reinterpret_cast<char *>(header_ + 1) + offset, size);
+                        return;
+                    }
+
+                    auto bytes = segment_bytes();
+                    while (size != 0)
+                    {
+                        auto len = (std::min)(size, bytes - offset % bytes);
+                        func(segments_[offset / bytes] + offset % bytes, len);
+                        offset += len;
+                        size -= len;
+                    }
+                }
+
+                /// 预先缺页, 对页面做不改变内容的原子加 0, 保证写入者访问时不再缺页
+                static void populate(char *addr, size_type size)
+                {
+#if defined(__linux__)
+                    auto range = page_align(addr, size);
+#if defined(MADV_POPULATE_WRITE)
+                    if (::madvise(range.first, range.second, MADV_POPULATE_WRITE) == 0)
+                        return;
+#endif
+                    auto page = static_cast<size_type>(::sysconf(_SC_PAGESIZE));
+                    for (size_type i = 0; i < range.second; i += page)
+                        __atomic_fetch_add(range.first + i, 0, __ATOMIC_RELAXED);
+#endif
+                }
+
+                void prefault_loop()
+                {
+                    // 每次最多预取 1MB 后释放锁, 避免长时间阻塞 remmap
+                    constexpr size_type chunk = 1 << 20;
+                    size_type done = 0;
+
+                    std::unique_lock<std::mutex> lock(map_mutex_);
+                    while (!prefault_stop_)
+                    {
+                        auto size = header_->size.load();
+                        auto target = (std::min)(size + options_.prefault, this->capacity());
+
+                        // 写入位置之前的页面已被写入者访问过
+                        done = (std::max)(done, size);
+                        if (done < target)
+                        {
+                            auto end = (std::min)(target, done + chunk);
+                            for_each_range(done, end - done, populate);
+                            for (auto &[other, scale] : attached_)
+                            {
+                                // 只预取附属映射当前已映射的部分, 它的映射由所属 table 的线程重建
+                                std::lock_guard<std::mutex> other_lock(other->map_mutex_);
+                                other->for_each_range(done * scale, (end - done) * scale, populate);
+                            }
+                            done = end;
+
+                            lock.unlock();
+                            std::this_thread::yield();
+                            lock.lock();
+                            continue;
+                        }
+
+                        prefault_cv_.wait_for(lock, std::chrono::milliseconds(1));
+                    }
+                }
+
+                void start_prefault()
+                {
+#if defined(__linux__)
+                    if (options_.prefault != 0 && mapped_region_mode_ == boost::interprocess::mode_t::read_write)
+                        prefault_thread_ = std::thread(&mmap::prefault_loop, this);
+#endif
+                }
+
+                void stop_prefault()
+                {
+                    if (!prefault_thread_.joinable())
+                        return;
+
+                    {
+                        std::lock_guard<std::mutex> lock(map_mutex_);
+                        prefault_stop_ = true;
+                    }
+                    prefault_cv_.notify_all();
+                    prefault_thread_.join();
+                }
+
+                /// 扩容一次, 调用者持有 header.lock 或是唯一的写入者
+                void do_recapacity(header &h)
+                {
+                    if (segment_shift_ != 0)
+                    {
+                        // 追加一个新段, 已有映射不受影响
+                        auto bytes = h.unit << segment_shift_;
+                        create_file(segment_path(h.capacity / bytes, true), bytes);
+                        h.capacity = h.capacity + bytes;
+                        return;
+                    }
+
+                    auto step = options_.growth_step == 0 ? h.capacity.load() : (options_.growth_step + h.unit - 1) / h.unit * h.unit;
+                    std::filesystem::resize_file(path_, h.capacity + step + sizeof(header));
+                    h.capacity = h.capacity + step;
+                }
+
+                void grow_loop()
+                {
+                    auto &h = *static_cast<header *>(grow_region_.get_address());
+
+                    std::unique_lock<std::mutex> lock(grow_mutex_);
+                    while (!grow_stop_)
+                    {
+                        // 先公布阈值再检查 size, 与写入者推进 size 后检查 grow_at_ 配对, 越过阈值的写入者一定会唤醒本线程
+                        auto capacity = h.capacity.load();
+                        auto threshold = static_cast<size_type>(double(capacity) * options_.growth_threshold);
+                        grow_at_.store(threshold);
+
+                        // 其他进程的写入者不会唤醒本线程, 空闲时按较长的间隔兜底检查
+                        auto interval = std::chrono::milliseconds(100);
+                        if (h.size.load() >= threshold)
+                        {
+                            if (!h.lock.exchange(true))
+                            {
+                                auto begin = stats_now();
+                                if (h.capacity == capacity)
+                                    do_recapacity(h);
+                                h.lock = false;
+                                h.capacity.notify_all();
+
+                                if constexpr (stats_enabled)
+                                {
+                                    h.stats.recapacity.fetch_add(1, boost::memory_order_relaxed);
+                                    h.stats.recapacity_ns.fetch_add(stats_now() - begin, boost::memory_order_relaxed);
+                                }
+                                continue;
+                            }
+
+                            // 抢不到锁说明写入者正在扩容, 稍后重新检查
+                            interval = std::chrono::milliseconds(1);
+                        }
+
+                        grow_cv_.wait_for(lock, interval, [this]()
+                                          { return grow_stop_ || grow_wake_; });
+                        grow_wake_ = false;
+                    }
+                }
+
+                void start_grow()
+                {
+                    if (options_.growth_threshold == 0 || !this->writable())
+                        return;
+
+                    grow_region_ = boost::interprocess::mapped_region(*file_mapp_, boost::interprocess::mode_t::read_write, 0, sizeof(header));
+                    grow_at_ = 0;
+                    grow_thread_ = std::thread(&mmap::grow_loop, this);
+                }
+
+                void stop_grow()
+                {
+                    if (!grow_thread_.joinable())
+                        return;
+
+                    {
+                        std::lock_guard<std::mutex> lock(grow_mutex_);
+                        grow_stop_ = true;
+                    }
+                    grow_cv_.notify_all();
+                    grow_thread_.join();
+                }
+
+                /// 把 a 推进到不小于 val
+                template <typename U>
+                static void advance(detail::atomic<U> &a, U val)
+                {
+                    for (auto cur = a.load(); cur < val && !a.compare_exchange_weak(cur, val);)
+                        ;
+                }
+
+                /// 推进 published_t::epoch 的水位 h.committed 并返回
+                /// epoch 从 e 切换到 e + 1 之前先确认 e - 1 登记的写入者都已离开, 此时 e - 1 切换前读取的 size (mark) 之前的数据都已写完
+                /// 每轮不阻塞, 一次调用最多切换两轮; 写入者持续登记时水位落后于 size, 登记后崩溃的写入者使水位停止推进, 直到 recover
+                static size_type publish(header &h)
+                {
+                    for (int round = 0; round < 2; ++round)
+                    {
+                        auto e = h.epoch.load();
+                        if (h.inflight[(e + 1) & 1].load() != 0)
+                            break;
+
+                        // 读取 mark 后 epoch 未变, 说明 mark 不是之后的轮次写入的, 旧轮次的值只会更小
+                        auto mark = h.mark[(e + 1) & 1].load();
+                        if (h.epoch.load() != e)
+                            continue;
+                        advance(h.committed, mark);
+
+                        auto size = h.size.load();
+                        auto expected = e;
+                        if (h.epoch.compare_exchange_strong(expected, e + 1))
+                            h.mark[e & 1].store(size);
+                    }
+                    return h.committed.load();
+                }
+
+                /// 之前的数据都已写完的字节数, 见 published_t
+                size_type published(header &h)
+                {
+                    switch (published_)
+                    {
+                    case published_t::committed:
+                        return h.committed.load(boost::memory_order_acquire);
+                    case published_t::epoch:
+                        return publish(h);
+                    default:
+                        return h.size.load(boost::memory_order_acquire);
+                    }
+                }
+
+                /// 递增 signal 并唤醒所有在 signal 上等待的线程 (读者, reactor, 刷盘线程与 sync)
+                static void wake(header &h)
+                {
+                    h.signal.fetch_add(1, boost::memory_order_release);
+                    h.signal.notify_all();
+                }
+
+                /// 刷盘一次, 调用者持有 flush_mutex_, 失败时返回 false 且不推进水位
+                /// 先读取请求序号与已发布水位, 刷盘完成后这些请求之前写入的数据与水位之前的数据都已落盘
+                /// 已占用但尚未写完的数据不计入 durable_size
+                bool do_flush(header &h)
+                {
+                    auto ticket = h.sync_requested.load();
+                    auto durable = (std::min)(this->published(h), h.capacity.load());
+
+                    if (!this->sync_files(h))
+                        return false;
+                    // 附属映射没有自己的水位, 按本映射的水位换算后推进其 durable_size
+                    for (auto &[other, scale] : attached_)
+                    {
+                        auto other_header = other->shared_header();
+                        if (other_header == nullptr || !other->sync_files(*other_header))
+                            return false;
+                        advance(other_header->durable_size, durable * scale);
+                    }
+
+                    advance(h.durable_size, durable);
+                    advance(h.sync_completed, ticket);
+                    return true;
+                }
+
+                /// 把数据文件 (分段存储时为 h.size 覆盖的段) 写回磁盘, 调用者持有刷盘线程所属映射的 flush_mutex_
+                bool sync_files(header &h)
+                {
+#if defined(__linux__)
+                    // fdatasync 只写回内核记录的脏页, 通过映射写入的页面同样会被写回
+                    size_type count = 1;
+                    if (h.segment_shift != 0)
+                    {
+                        auto size = (std::min)(h.size.load(), h.capacity.load());
+                        auto bytes = h.unit << h.segment_shift;
+                        count = (std::max)((size + bytes - 1) / bytes, size_type(1));
+                    }
+
+                    while (flush_fds_.size() < count)
+                    {
+                        auto index = flush_fds_.size();
+                        auto fd = ::open((index == 0 ? path_ : segment_path(index)).c_str(), O_RDWR | O_CLOEXEC);
+                        if (fd < 0)
+                            return false;
+                        flush_fds_.push_back(fd);
+                    }
+
+                    for (size_type i = 0; i < count; ++i)
+                    {
+                        if (::fdatasync(flush_fds_[i]) != 0)
+                            return false;
+                    }
+#else
+                    // 只在调用 sync 的线程中执行, 映射不会被并发重建
+                    if (!region_->flush(0, 0, false))
+                        return false;
+                    for (auto &region : segment_regions_)
+                    {
+                        if (!region.flush(0, 0, false))
+                            return false;
+                    }
+#endif
+                    return true;
+                }
+
+                /// 已发布但未刷盘的字节数
+                size_type dirty(header &h)
+                {
+                    auto published = (std::min)(this->published(h), h.capacity.load());
+                    auto durable = h.durable_size.load();
+                    return published > durable ? published - durable : 0;
+                }
+
+                /// 有 sync 请求时立即刷盘, 刷盘期间到达的请求合并到下一次; 刷盘后唤醒等待 sync 的线程
+                /// group_commit 空闲时登记为 watcher 并在 signal 上阻塞, 由写入者发布或 sync 唤醒, 不轮询
+                /// periodic 不登记 (写入者不必为它唤醒), 按间隔醒来; 设置了 sync_bytes 时每 1ms 检查一次未刷盘字节数
+                void flush_loop()
+                {
+                    auto &h = *static_cast<header *>(flush_region_.get_address());
+                    auto group = options_.durability == durability_t::group_commit;
+                    auto interval = std::chrono::nanoseconds(std::chrono::milliseconds(options_.sync_interval));
+                    // 刷盘失败后的重试间隔, 以及 periodic 检查 sync_bytes 的间隔
+                    auto retry = std::chrono::nanoseconds(std::chrono::milliseconds(1));
+                    auto last = std::chrono::steady_clock::now();
+
+                    while (!flush_stop_.load())
+                    {
+                        auto now = std::chrono::steady_clock::now();
+                        auto dirty = this->dirty(h);
+                        auto pending = h.sync_requested.load() > h.sync_completed.load();
+                        auto due = pending || (dirty != 0 && (group || now - last >= interval ||
+                                                               (options_.sync_bytes != 0 && dirty >= options_.sync_bytes)));
+
+                        if (due)
+                        {
+                            std::lock_guard<std::mutex> lock(flush_mutex_);
+                            if (this->do_flush(h))
+                            {
+                                wake(h);
+                                last = now;
+                                continue;
+                            }
+                        }
+
+                        if (group && !due)
+                        {
+                            // 先登记再读取 signal 并重新检查, 与写入者发布数据, seq_cst fence, 检查 watchers 配对
+                            h.watchers.fetch_add(1);
+                            auto seen = h.signal.load();
+                            if (!flush_stop_.load() && this->dirty(h) == 0 && h.sync_requested.load() <= h.sync_completed.load())
+                                timed_wait(h.signal, seen, std::chrono::nanoseconds(0));
+                            h.watchers.fetch_sub(1);
+                            continue;
+                        }
+
+                        // 没有未刷盘数据时睡眠一个间隔
+                        auto timeout = interval;
+                        if (due)
+                            timeout = retry;
+                        else if (dirty != 0)
+                        {
+                            timeout = interval - (now - last);
+                            if (options_.sync_bytes != 0)
+                                timeout = (std::min)(timeout, retry);
+                        }
+
+                        // stop_flush 与 sync 先写入标志或请求再递增 signal, 读取 signal 之后检查标志不会错过唤醒
+                        auto seen = h.signal.load();
+                        if (!flush_stop_.load() && h.sync_requested.load() <= h.sync_completed.load())
+                            timed_wait(h.signal, seen, timeout);
+                    }
+
+                    // 关闭前刷盘一次
+                    std::lock_guard<std::mutex> lock(flush_mutex_);
+                    if (this->do_flush(h))
+                        wake(h);
+                }
+
+                void start_flush()
+                {
+                    if (options_.durability == durability_t::none || !this->writable())
+                        return;
+
+#if defined(__linux__)
+                    flush_region_ = boost::interprocess::mapped_region(*file_mapp_, boost::interprocess::mode_t::read_write, 0, sizeof(header));
+                    flush_thread_ = std::thread(&mmap::flush_loop, this);
+#else
+                    throw std::runtime_error("durability is only supported on linux");
+#endif
+                }
+
+                void stop_flush()
+                {
+                    if (flush_thread_.joinable())
+                    {
+                        flush_stop_ = true;
+                        wake(*static_cast<header *>(flush_region_.get_address()));
+                        flush_thread_.join();
+                    }
+
+#if defined(__linux__)
+                    for (auto fd : flush_fds_)
+                        ::close(fd);
+#endif
+                    flush_fds_.clear();
+                }
+
+                std::string segment_name(size_type index) const
+                {
+                    return mmap_name_ + "." + std::to_string(index);
+                }
+
+                std::string segment_path(size_type index, bool create = false) const
+                {
+                    return backend_path(segment_name(index), options_.backend, create);
+                }
+
+                size_type segment_bytes() const
                 {
-                    std::filebuf fbuf;
-                    if (nullptr == fbuf.open(mmap_name_, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary))
-                        throw std::runtime_error("failed to create file " + mmap_name_);
-                    fbuf.pubseekoff(size - 1, std::ios::beg);
-                    fbuf.sputc(0);
+                    return header_->unit << segment_shift_;
                 }
 
-                void create_only(size_type capacity)
+                void load_segments()
+                {
+                    segment_shift_ = header_->segment_shift;
+                    segment_mask_ = (size_type(1) << segment_shift_) - 1;
+                    segments_.clear();
+
+                    if (segment_shift_ != 0)
+                        segments_.push_back(reinterpret_cast<char *>(header_ + 1));
+                }
+
+                void reserve(size_type size)
+                {
+                    if (size == 0)
+                        return;
+
+#if defined(__linux__)
+                    auto addr = ::mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+                    if (addr == MAP_FAILED)
+                        throw std::runtime_error("failed to reserve address space for " + mmap_name_);
+
+                    reserved_ = static_cast<char *>(addr);
+                    reserved_size_ = size;
+#else
+                    throw std::runtime_error("reserve is only supported on linux");
+#endif
+                }
+
+                void release()
+                {
+#if defined(__linux__)
+                    // 文件映射位于预留区间内, 一并解除
+                    if (reserved_ != nullptr)
+                        ::munmap(reserved_, reserved_size_);
+                    reserved_ = nullptr;
+#endif
+                }
+
+                /// 映射整个文件, 预留地址空间时只补映射新增的部分
+                void map()
                 {
                     using namespace boost::interprocess;
 
-                    this->create_file(sizeof(header) + capacity);
+                    if (reserved_ == nullptr)
+                    {
+                        if (region_)
+                        {
+                            region_->~mapped_region();
+                            new (region_.get()) mapped_region(*file_mapp_, mapped_region_mode_);
+                        }
+                        else
+                        {
+                            region_ = std::make_unique<mapped_region>(*file_mapp_, mapped_region_mode_);
+                        }
+
+                        header_ = static_cast<header *>(region_->get_address());
+                        mapped_size_ = region_->get_size();
+                        hint(region_->get_address(), mapped_size_);
+                        return;
+                    }
+
+#if defined(__linux__)
+                    auto fd = file_mapp_->get_mapping_handle().handle;
+                    struct stat st;
+                    if (::fstat(fd, &st) != 0)
+                        throw std::runtime_error("failed to stat file " + mmap_name_);
+
+                    auto size = static_cast<size_type>(st.st_size);
+                    if (size > reserved_size_)
+                        throw std::runtime_error("file larger than reserved address space " + mmap_name_);
+
+                    // 已映射部分按页向上取整, 新映射从下一页开始, 不覆盖已有映射
+                    auto page = static_cast<size_type>(::sysconf(_SC_PAGESIZE));
+                    auto begin = (mapped_size_ + page - 1) / page * page;
+                    if (size > begin)
+                    {
+                        int prot = PROT_READ;
+                        int flags = MAP_FIXED;
+                        switch (mapped_region_mode_)
+                        {
+                        case boost::interprocess::mode_t::read_write:
+                            prot |= PROT_WRITE;
+                            flags |= MAP_SHARED;
+                            break;
+                        case boost::interprocess::mode_t::read_only:
+                            flags |= MAP_SHARED;
+                            break;
+                        case boost::interprocess::mode_t::read_private:
+                            flags |= MAP_PRIVATE;
+                            break;
+                        default:
+                            prot |= PROT_WRITE;
+                            flags |= MAP_PRIVATE;
+                            break;
+                        }
+
+                        if (::mmap(reserved_ + begin, size - begin, prot, flags, fd, begin) == MAP_FAILED)
+                            throw std::runtime_error("failed to map file " + mmap_name_);
+                        hint(reserved_ + begin, size - begin);
+                    }
+
+                    header_ = reinterpret_cast<header *>(reserved_);
+                    mapped_size_ = size;
+#endif
+                }
+
+                void create_only(size_type capacity, const options &opts, size_type unit)
+                {
+                    using namespace boost::interprocess;
+
+                    size_type segment_shift = 0;
+                    if (opts.segment != 0)
+                    {
+                        if (opts.reserve != 0)
+                            throw std::runtime_error("reserve can not be used with segment");
+                        // 新段的 memfd 只登记在扩容的进程中, 其他进程无法按名字打开
+                        if (opts.backend == backend_t::memfd)
+                            throw std::runtime_error("memfd backend can not be used with segment");
+
+                        if (opts.segment == 1 || (opts.segment & (opts.segment - 1)) != 0)
+                            throw std::runtime_error("segment must be a power of 2");
+
+                        while ((size_type(1) << segment_shift) < opts.segment)
+                            ++segment_shift;
+                    }
+
+                    auto size = segment_shift != 0 ? unit << segment_shift : capacity;
+                    path_ = backend_path(mmap_name_, options_.backend, true);
+                    create_file(path_, sizeof(header) + size);
 
+                    file_mapping_mode_ = boost::interprocess::mode_t::read_write;
                     mapped_region_mode_ = boost::interprocess::mode_t::read_write;
-                    file_mapp_ = std::make_unique<file_mapping>(mmap_name_.c_str(), boost::interprocess::mode_t::read_write);
-                    region_ = std::make_unique<mapped_region>(*file_mapp_, mapped_region_mode_);
+                    file_mapp_ = std::make_unique<file_mapping>(path_.c_str(), boost::interprocess::mode_t::read_write);
+                    this->map();
 
-                    header_ = new (region_->get_address()) header;
+                    header_ = new (header_) header;
+                    header_->magic = format_magic;
+                    header_->version = format_version;
                     header_->size = 0;
                     header_->lock = false;
-                    header_->capacity = capacity;
+                    header_->owner = 0;
+                    header_->waiters = 0;
+                    header_->watchers = 0;
+                    header_->signal = 0;
+                    header_->committed = 0;
+                    header_->epoch = 0;
+                    for (auto i : {0, 1})
+                    {
+                        header_->inflight[i] = 0;
+                        header_->mark[i] = 0;
+                    }
+                    header_->durable_size = 0;
+                    header_->sync_requested = 0;
+                    header_->sync_completed = 0;
+                    header_->discarded = 0;
+                    header_->capacity = size;
+                    header_->segment_shift = segment_shift;
+                    header_->unit = unit;
+                    header_->stats.clear();
+                    load_segments();
+
+                    if (segment_shift_ != 0)
+                    {
+                        while (header_->capacity < capacity)
+                            recapacity();
+                        remmap();
+                    }
                 }
 
                 void open_only(boost::interprocess::mode_t file_mapping_mode, boost::interprocess::mode_t mapped_region_mode, std::size_t capacity)
                 {
                     using namespace boost::interprocess;
 
+                    file_mapping_mode_ = file_mapping_mode;
                     mapped_region_mode_ = mapped_region_mode;
-                    file_mapp_ = std::make_unique<file_mapping>(mmap_name_.c_str(), file_mapping_mode);
-                    region_ = std::make_unique<mapped_region>(*file_mapp_, mapped_region_mode_);
-                    header_ = static_cast<header *>(region_->get_address());
+                    path_ = backend_path(mmap_name_, options_.backend, false);
+                    file_mapp_ = std::make_unique<file_mapping>(path_.c_str(), file_mapping_mode);
+                    this->map();
+
+                    if (mapped_size_ < sizeof(header) || header_->magic != format_magic)
+                    {
+                        release();
+                        throw std::runtime_error("not a lightmdb file " + mmap_name_);
+                    }
+                    if (header_->version != format_version)
+                    {
+                        auto version = header_->version;
+                        release();
+                        throw std::runtime_error("unsupported format version " + std::to_string(version) + " of " + mmap_name_);
+                    }
+                    load_segments();
+
+                    if (segment_shift_ != 0 && reserved_ != nullptr)
+                    {
+                        release();
+                        throw std::runtime_error("reserve can not be used with segment");
+                    }
 
                     if (header_->capacity < capacity)
                     {
-                        std::filesystem::resize_file(mmap_name_, capacity + sizeof(header));
-                        header_->capacity = capacity;
+                        if (segment_shift_ != 0)
+                        {
+                            while (header_->capacity < capacity)
+                                recapacity();
+                        }
+                        else
+                        {
+                            std::filesystem::resize_file(path_, capacity + sizeof(header));
+                            header_->capacity = capacity;
+                        }
+                        remmap();
+                    }
+                    else if (segment_shift_ != 0)
+                    {
                         remmap();
                     }
                 }
 
             public:
-                mmap(std::string_view name, mode_t mode, size_type capacity)
-                    : mmap_name_(name)
+                /// unit 为元素大小, 分段存储时按元素划分段, 保证元素不会跨段; published 为 table 发布数据的方式, 见 published_t
+                mmap(std::string_view name, mode_t mode, size_type capacity, const options &opts = {}, size_type unit = 1, published_t published = published_t::size)
+                    : mmap_name_(name), options_(opts), published_(published)
                 {
+                    this->reserve(opts.reserve);
                     switch (mode)
                     {
                     case mode_t::create_only:
-                        create_only(capacity);
+                        create_only(capacity, opts, unit);
                         break;
                     case mode_t::open_or_create:
-                        if (std::filesystem::exists(name))
+                        if (backend_exists(name, opts.backend))
                             open_only(boost::interprocess::mode_t::read_write, boost::interprocess::mode_t::read_write, capacity);
                         else
-                            create_only(capacity);
+                            create_only(capacity, opts, unit);
                         break;
                     default:
                         throw std::runtime_error("error mode");
                     }
+                    start_prefault();
+                    start_flush();
+                    start_grow();
                 }
 
-                mmap(std::string_view name, mode_t mode)
-                    : mmap_name_(name)
+                mmap(std::string_view name, mode_t mode, const options &opts = {}, published_t published = published_t::size)
+                    : mmap_name_(name), options_(opts), published_(published)
                 {
+                    this->reserve(opts.reserve);
                     switch (mode)
                     {
                     case mode_t::read_write:
@@ -135,9 +1235,21 @@ namespace air
                     default:
                         throw std::runtime_error("error mode");
                     }
+                    start_prefault();
+                    start_flush();
+                    start_grow();
                 }
 
-                ~mmap() = default;
+                mmap(const mmap &) = delete;
+                mmap &operator=(const mmap &) = delete;
+
+                ~mmap()
+                {
+                    stop_grow();
+                    stop_prefault();
+                    stop_flush();
+                    release();
+                }
 
                 size_type size() const
                 {
@@ -151,53 +1263,494 @@ namespace air
 
                 size_type capacity() const
                 {
-                    return region_->get_size() - sizeof(header);
+                    if (segment_shift_ != 0)
+                        return segments_.size() * segment_bytes();
+
+                    return mapped_size_ - sizeof(header);
+                }
+
+                /// 单段最大字节数, 连续存储时不限制
+                size_type segment_size() const
+                {
+                    return segment_shift_ != 0 ? segment_bytes() : max_size();
+                }
+
+                /// [index, index + count) 个元素是否位于同一段内
+                bool contiguous(size_type index, size_type count) const
+                {
+                    return segment_shift_ == 0 || count == 0 || (index >> segment_shift_) == ((index + count - 1) >> segment_shift_);
+                }
+
+                /// 写入者占用到 end 字节后调用: 越过扩容阈值时唤醒本进程的后台扩容线程, 每次扩容只有一个写入者唤醒
+                /// 没有后台扩容线程时只有一次 load
+                void claimed(size_type end)
+                {
+                    if (end < grow_at_.load() || grow_at_.exchange(max_size()) == max_size())
+                        return;
+
+                    {
+                        std::lock_guard<std::mutex> lock(grow_mutex_);
+                        grow_wake_ = true;
+                    }
+                    grow_cv_.notify_one();
                 }
 
                 void recapacity()
                 {
-                    std::filesystem::resize_file(mmap_name_, header_->capacity * 2 + sizeof(header));
-                    header_->capacity = header_->capacity * 2;
+                    auto begin = stats_now();
+                    this->do_recapacity(*header_);
+
+                    this->count(&stats::recapacity);
+                    this->count(&stats::recapacity_ns, stats_now() - begin);
+                }
+
+                /// 写入者保证本地映射覆盖数据区前 end 字节, 各 table 的扩容循环
+                /// local() 返回 table 记录的本地 capacity (字节), remap() 重建映射并更新它, grow() 扩容一次
+                /// locked 为 true 时抢到 header.lock 的写入者扩容, 其余写入者等待共享 capacity 变化; 否则由唯一的写入者直接扩容
+                /// 只有共享 capacity 仍等于本地 capacity 时才扩容, 否则其他进程已经扩过了
+                template <typename Local, typename Remap, typename Grow>
+                void reserve_until(size_type end, bool locked, Local &&local, Remap &&remap, Grow &&grow)
+                {
+                    this->claimed(end);
+                    while (end > local())
+                    {
+                        // remap 会重建映射, header 的引用不能跨轮次保存
+                        auto &h = *header_;
+                        if (locked)
+                        {
+                            if (h.lock.exchange(true))
+                                this->count(&stats::lock_spins);
+                            else
+                            {
+                                if (h.capacity == local())
+                                    grow();
+
+                                h.lock = false;
+                                h.capacity.notify_all();
+                            }
+
+                            h.capacity.wait(local());
+                        }
+                        else
+                        {
+                            if (h.capacity == local())
+                                grow();
+                            h.capacity.notify_all();
+                        }
+                        remap();
+                    }
+                }
+
+                template <typename Local, typename Remap>
+                void reserve_until(size_type end, bool locked, Local &&local, Remap &&remap)
+                {
+                    this->reserve_until(end, locked, std::forward<Local>(local), std::forward<Remap>(remap), [this]()
+                                        { this->recapacity(); });
                 }
 
                 void remmap()
+                {
+                    auto begin = stats_now();
+                    {
+                        std::lock_guard<std::mutex> lock(map_mutex_);
+                        this->do_remmap();
+                    }
+
+                    this->count(&stats::remmap);
+                    this->count(&stats::remmap_ns, stats_now() - begin);
+                }
+
+                /// 统计计数器加 val, 未启用统计时为空操作
+                /// 只读映射的读者 (remmap, capacity_waits, waits, wakeups) 通过 shared_header 计数, 文件没有写权限时不计数
+                void count(detail::atomic<std::uint64_t> stats::*counter, std::uint64_t val = 1)
+                {
+                    if constexpr (stats_enabled)
+                    {
+                        auto h = this->writable() ? header_ : this->shared_header();
+                        if (h != nullptr)
+                            (h->stats.*counter).fetch_add(val, boost::memory_order_relaxed);
+                    }
+                }
+
+                void do_remmap()
                 {
                     using namespace boost::interprocess;
 
-                    region_->~mapped_region();
-                    new (region_.get()) mapped_region(*file_mapp_, mapped_region_mode_);
-                    header_ = static_cast<header *>(region_->get_address());
+                    if (segment_shift_ != 0)
+                    {
+                        // 只映射新增的段, 已有段的地址保持不变
+                        for (auto count = header_->capacity / segment_bytes(); segments_.size() < count;)
+                        {
+                            auto &file = segment_files_.emplace_back(segment_path(segments_.size()).c_str(), file_mapping_mode_);
+                            auto &region = segment_regions_.emplace_back(file, mapped_region_mode_);
+                            segments_.push_back(static_cast<char *>(region.get_address()));
+                            hint(region.get_address(), region.get_size());
+                        }
+                        return;
+                    }
+
+                    this->map();
                 }
 
                 void shrink_to_fit()
+                {
+                    this->shrink_to_fit(header_->size.load());
+                }
+
+                /// 把数据区收缩到 size 字节
+                void shrink_to_fit(size_type size)
                 {
                     using namespace boost::interprocess;
-                    auto size = header_->size.load();
+                    std::lock_guard<std::mutex> lock(map_mutex_);
+
+                    if (segment_shift_ != 0)
+                    {
+                        // 删除尾部未使用的段, 至少保留第 0 段
+                        do_remmap();
+                        auto bytes = segment_bytes();
+                        auto count = (std::max)((size + bytes - 1) / bytes, size_type(1));
+
+                        header_->capacity = count * bytes;
+                        while (segments_.size() > count)
+                        {
+                            segment_regions_.pop_back();
+                            segment_files_.pop_back();
+                            segments_.pop_back();
+                            backend_remove(segment_name(segments_.size()), options_.backend);
+                        }
+                        return;
+                    }
+
+#if defined(__linux__)
+                    if (reserved_ != nullptr)
+                    {
+                        // 截断部分恢复为预留状态, 避免访问到文件末尾之后产生 SIGBUS
+                        auto page = static_cast<size_type>(::sysconf(_SC_PAGESIZE));
+                        auto begin = (sizeof(header) + size + page - 1) / page * page;
+                        auto end = (mapped_size_ + page - 1) / page * page;
+                        if (end > begin)
+                            ::mmap(reserved_ + begin, end - begin, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+
+                        std::filesystem::resize_file(path_, sizeof(header) + size);
+                        mapped_size_ = sizeof(header) + size;
+                        header_->capacity = size;
+                        return;
+                    }
+#endif
 
                     // 不卸载映射直接resize_file 在Windows上会出现问题
                     region_->~mapped_region();
-                    std::filesystem::resize_file(mmap_name_, sizeof(header) + size);
+                    std::filesystem::resize_file(path_, sizeof(header) + size);
                     new (region_.get()) mapped_region(*file_mapp_, mapped_region_mode_);
 
                     header_ = static_cast<header *>(region_->get_address());
+                    mapped_size_ = region_->get_size();
                     header_->capacity = size;
                 }
 
+                /// 释放数据区前 size 字节 (不超过 header.size): 在文件中打洞 (PUNCH_HOLE) 并丢弃映射的页面 (MADV_DONTNEED)
+                /// 文件大小, 映射与下标都不变, 只回收磁盘空间与内存; 只处理完整的页, 每次从上次释放到的位置继续
+                /// 被释放的数据读出为 0, 调用者保证不再读取 (例如 size 不超过所有消费者已提交的位置)
+                /// 文件系统不支持打洞时返回 false, 此时只丢弃页面, header.discarded 照常推进
+                bool discard(size_type size)
+                {
+                    if (!this->writable())
+                        throw std::runtime_error("discard requires a writable mapping " + mmap_name_);
+
+                    auto &h = *header_;
+                    size = (std::min)({size, static_cast<size_type>(h.size.load()), this->capacity()});
+                    auto begin = h.discarded.load();
+                    if (size <= begin)
+                        return true;
+
+                    auto punched = true;
+#if defined(__linux__)
+                    auto page = static_cast<size_type>(::sysconf(_SC_PAGESIZE));
+                    auto bytes = segment_shift_ != 0 ? segment_bytes() : max_size();
+                    for (auto offset = begin; offset < size;)
+                    {
+                        // 第 0 段 (连续存储时即整个数据区) 位于主文件 header 之后
+                        auto index = offset / bytes;
+                        auto base = index == 0 ? sizeof(header) : 0;
+                        auto fd = index == 0 ? file_mapp_->get_mapping_handle().handle : segment_files_[index - 1].get_mapping_handle().handle;
+                        auto end = (std::min)(size, index == 0 && segment_shift_ == 0 ? size : (index + 1) * bytes);
+
+                        // 上次未满一页的部分向前补齐, 但不能进入 header 所在的页
+                        auto first = (std::max)((base + offset % bytes) / page * page, (base + page - 1) / page * page);
+                        auto last = (base + (end - 1) % bytes + 1) / page * page;
+                        if (last > first)
+                        {
+                            if (::fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, first, last - first) != 0)
+                                punched = false;
+                            auto addr = (index == 0 ? reinterpret_cast<char *>(header_) : segments_[index]) + first;
+                            ::madvise(addr, last - first, MADV_DONTNEED);
+                        }
+                        offset = end;
+                    }
+#endif
+                    advance(h.discarded, size);
+                    return punched;
+                }
+
+                /// 已释放的数据区前缀字节数
+                size_type discarded() const
+                {
+                    return header_->discarded;
+                }
+
+                /// 以可写方式单独映射的 header, 地址在 mmap 的生命周期内不变, 首次调用时创建
+                /// 只读映射 (包括 read_private/copy_on_write 的私有映射) 通过它登记 waiters/watchers 并在共享的 signal 上等待
+                /// 文件没有写权限时返回 nullptr, 调用者退化为轮询
+                header *shared_header()
+                {
+                    std::call_once(shared_once_, [this]()
+                                   {
+                        using namespace boost::interprocess;
+                        try
+                        {
+                            shared_file_ = std::make_unique<file_mapping>(path_.c_str(), boost::interprocess::mode_t::read_write);
+                            shared_region_ = mapped_region(*shared_file_, boost::interprocess::mode_t::read_write, 0, sizeof(header));
+                            shared_header_ = static_cast<header *>(shared_region_.get_address());
+                        }
+                        catch (const interprocess_exception &)
+                        {
+                            shared_file_.reset();
+                        } });
+                    return shared_header_;
+                }
+
+                /// 阻塞直到 ready() 返回 true: 在 header.waiters 登记后等待 header.signal, 写入者发布后递增 signal 并唤醒
+                /// 只读映射同样通过 shared_header 登记, 不必轮询; 没有写权限或 32 位原子没有原生 futex 时轮询
+                template <typename Ready>
+                void wait(Ready &&ready)
+                {
+                    if (ready())
+                        return;
+
+                    header *h = nullptr;
+                    if constexpr (detail::atomic<std::uint32_t>::always_has_native_wait_notify)
+                        h = this->shared_header();
+                    if (h == nullptr)
+                        return detail::poll_wait(ready);
+
+                    // 先登记再读取 signal 并检查, 与写入者发布数据, seq_cst fence, 检查 waiters 配对
+                    // ready 可能重建本地映射, 因此只使用地址不变的 shared_header
+                    h->waiters.fetch_add(1);
+                    this->count(&stats::waits);
+                    for (auto seen = h->signal.load(); !ready(); seen = h->signal.load())
+                        h->signal.wait(seen);
+                    h->waiters.fetch_sub(1);
+                    this->count(&stats::wakeups);
+                }
+
+                /// 是否有阻塞的读者或登记的 reactor, relaxed 读取, 没有 seq_cst fence 时可能看不到刚登记的等待者
+                bool watched() const
+                {
+                    return header_->waiters.load(boost::memory_order_relaxed) != 0 || header_->watchers.load(boost::memory_order_relaxed) != 0;
+                }
+
+                /// 有阻塞的读者或登记的 reactor 时递增 signal 并唤醒, 调用者已在发布数据后执行 seq_cst fence
+                /// 没有等待者时只读取 waiters/watchers, 不写 header
+                void notify()
+                {
+                    auto &h = *header_;
+                    if (h.waiters.load(boost::memory_order_relaxed) == 0 && h.watchers.load(boost::memory_order_relaxed) == 0)
+                        return;
+
+                    h.signal.fetch_add(1, boost::memory_order_release);
+                    h.signal.notify_all();
+                    this->count(&stats::notifies);
+                }
+
+                /// 持有者崩溃后可以恢复的进程间锁, header.owner 为持锁进程的 pid; 持锁进程已退出时由等待者接管
+                /// 接管时被保护的数据可能只更新了一半, 调用者保证这种状态仍然可用; 同一进程的线程之间按自旋锁互斥
+                /// pid 被新进程复用时要等到该进程退出才能接管
+                void lock_owner()
+                {
+                    auto &h = *header_;
+                    auto self = detail::process_id();
+                    for (size_type i = 0;; ++i)
+                    {
+                        std::uint32_t owner = 0;
+                        if (h.owner.compare_exchange_weak(owner, self))
+                            return;
+
+                        // 自旋一段时间后才检查持有者是否存在, 正常的短临界区不发起系统调用
+                        if (i < 1024)
+                            detail::pause();
+                        else if (owner != 0 && !detail::process_alive(owner) && h.owner.compare_exchange_strong(owner, self))
+                            return;
+                        else
+                            std::this_thread::yield();
+                    }
+                }
+
+                void unlock_owner()
+                {
+                    header_->owner.store(0, boost::memory_order_release);
+                }
+
+                /// published_t::epoch 的写入者在占用数据之前登记, 返回 leave 使用的槽位
+                /// 登记后重新读取 epoch, 登记到已切换的 epoch 时撤销重试, 保证 publish 判定排空的槽位之后不会再有登记
+                std::uint32_t enter()
+                {
+                    auto &h = *header_;
+                    for (;;)
+                    {
+                        auto e = h.epoch.load();
+                        h.inflight[e & 1].fetch_add(1);
+                        if (h.epoch.load() == e)
+                            return e & 1;
+                        h.inflight[e & 1].fetch_sub(1);
+                    }
+                }
+
+                /// 登记的写入者发布数据 (写完并建立索引) 之后离开, 并唤醒等待水位的刷盘线程
+                void leave(std::uint32_t slot)
+                {
+                    header_->inflight[slot].fetch_sub(1);
+                    boost::atomic_thread_fence(boost::memory_order_seq_cst);
+                    this->notify();
+                }
+
+                /// 推进并返回 published_t::epoch 的水位, 之前的数据都已写完, 见 publish(header &)
+                size_type publish()
+                {
+                    return publish(*header_);
+                }
+
+                /// 崩溃恢复时清除崩溃的写入者留下的登记, 调用时不能有其他写入者
+                void reset_writers()
+                {
+                    auto &h = *header_;
+                    h.inflight[0] = 0;
+                    h.inflight[1] = 0;
+                    publish(h);
+                }
+
+                /// 已刷盘的数据字节数
+                size_type durable_size() const
+                {
+                    return header_->durable_size;
+                }
+
+                /// 保证调用前写入的数据都已刷盘 (group commit)
+                /// 有刷盘线程时唤醒它并等待其完成一次覆盖本次请求的刷盘, 否则在调用线程中刷盘
+                /// 等待使用 32 位的 signal (刷盘线程刷盘后递增), 64 位的 sync_completed 没有原生 futex
+                void sync()
+                {
+                    if (!this->writable())
+                        throw std::runtime_error("sync requires a writable mapping " + mmap_name_);
+
+                    if (flush_thread_.joinable())
+                    {
+                        // 刷盘线程的 header 映射地址不随 remmap 变化
+                        auto &h = *static_cast<header *>(flush_region_.get_address());
+                        auto ticket = h.sync_requested.fetch_add(1) + 1;
+                        wake(h);
+
+                        h.waiters.fetch_add(1);
+                        for (auto seen = h.signal.load(); h.sync_completed.load() < ticket; seen = h.signal.load())
+                            h.signal.wait(seen);
+                        h.waiters.fetch_sub(1);
+                        return;
+                    }
+
+                    auto &h = *header_;
+                    auto ticket = h.sync_requested.fetch_add(1) + 1;
+                    std::lock_guard<std::mutex> lock(flush_mutex_);
+                    if (h.sync_completed.load() < ticket && !do_flush(h))
+                        throw std::runtime_error("failed to sync file " + mmap_name_);
+                }
+
+                /// 附属映射 other 不维护自己的水位 (例如列式 table 的各列), 由本映射的刷盘与预取线程一并处理
+                /// 本映射的每字节对应 other 的 scale 字节; other 必须比本映射后销毁, 且自身不开启 durability 与 prefault
+                void attach(mmap &other, size_type scale)
+                {
+                    std::scoped_lock lock(map_mutex_, flush_mutex_);
+                    attached_.emplace_back(&other, scale);
+                }
+
                 header &get_header()
                 {
                     return *header_;
                 }
 
+                /// 对数据区 [offset, offset + size) 字节调用 madvise, 超出本地映射的部分忽略
+                void advise(size_type offset, size_type size, advice_t advice)
+                {
+#if defined(__linux__)
+                    for_each_range(offset, size, [advice](char *addr, size_type len)
+                                   {
+                        auto range = page_align(addr, len);
+                        ::madvise(range.first, range.second, to_madvise(advice)); });
+#endif
+                }
+
                 void *get_address()
                 {
-                    return &static_cast<header *>(region_->get_address())[1];
+                    return header_ + 1;
+                }
+
+                /// 第 index 个元素的地址, 要求 sizeof(U) 与创建时的 unit 一致
+                template <typename U>
+                U *at(size_type index)
+                {
+                    if (segment_shift_ == 0)
+                        return reinterpret_cast<U *>(header_ + 1) + index;
+
+                    return reinterpret_cast<U *>(segments_[index >> segment_shift_]) + (index & segment_mask_);
+                }
+
+                /// 是否为共享的可写映射, 只有这种映射才能修改其他进程可见的 header
+                bool writable() const
+                {
+                    return mapped_region_mode_ == boost::interprocess::mode_t::read_write;
                 }
 
                 const std::string &name() const
                 {
                     return mmap_name_;
                 }
+
+                /// 主文件在存储后端中的路径
+                const std::string &path() const
+                {
+                    return path_;
+                }
             };
         }
+
+        /// 删除存储后端中的文件, memfd 后端关闭登记的描述符
+        inline bool remove(std::string_view name, const options &opts = {})
+        {
+            return detail::backend_remove(name, opts.backend);
+        }
+
+        /// memfd 后端下 name 对应的描述符, 用于通过 SCM_RIGHTS 传给其他进程; 不存在时返回 -1
+        inline int memfd(std::string_view name)
+        {
+            auto &registry = detail::memfds();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            auto it = registry.fds.find(name);
+            return it != registry.fds.end() ? it->second : -1;
+        }
+
+        /// 登记从其他进程收到的 memfd 描述符, 之后可以用 memfd 后端按 name 打开; 登记表接管描述符
+        inline void memfd_register(std::string_view name, int fd)
+        {
+            auto &registry = detail::memfds();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            auto it = registry.fds.find(name);
+            if (it != registry.fds.end())
+            {
+#if defined(__linux__)
+                ::close(it->second);
+#endif
+                it->second = fd;
+            }
+            else
+                registry.fds.emplace(name, fd);
+        }
     }
 }
\ No newline at end of file
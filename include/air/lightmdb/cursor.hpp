@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cstddef>
+#include <thread>
+#include <utility>
+
+#include "air/lightmdb/core.hpp"
+#include "air/lightmdb/async.hpp"
+
+namespace air
+{
+    namespace lightmdb
+    {
+        /// 等待策略, ready 为非阻塞检查, block 为阻塞等待 (table::wait)
+        namespace wait
+        {
+            /// 一直自旋, 从不让出 CPU, 适合独占核心的读者
+            struct busy_spin
+            {
+                template <typename Ready, typename Block>
+                void operator()(Ready &&ready, Block &&) const
+                {
+                    while (!ready())
+                        detail::pause();
+                }
+            };
+
+            /// 先自旋 spin 次, 之后每次检查前让出时间片
+            struct spin_yield
+            {
+                std::size_t spin = 1024;
+
+                template <typename Ready, typename Block>
+                void operator()(Ready &&ready, Block &&) const
+                {
+                    for (std::size_t i = 0; !ready(); ++i)
+                    {
+                        if (i < spin)
+                            detail::pause();
+                        else
+                            std::this_thread::yield();
+                    }
+                }
+            };
+
+            /// 先自旋 spin 次, 之后进入阻塞等待
+            struct spin_block
+            {
+                std::size_t spin = 1024;
+
+                template <typename Ready, typename Block>
+                void operator()(Ready &&ready, Block &&block) const
+                {
+                    for (std::size_t i = 0; i < spin; ++i)
+                    {
+                        if (ready())
+                            return;
+                        detail::pause();
+                    }
+                    block();
+                }
+            };
+
+            /// 直接阻塞等待
+            struct block
+            {
+                template <typename Ready, typename Block>
+                void operator()(Ready &&ready, Block &&block) const
+                {
+                    if (!ready())
+                        block();
+                }
+            };
+        }
+
+        /// 顺序读取 table 的游标, 适用于 fixed::table, variable::table 与 framed::table
+        /// framed::table 的 position 为帧偏移, 由 table.next 推进
+        template <typename Table, typename WaitPolicy = wait::block>
+        class cursor
+        {
+        public:
+            using table_type = Table;
+            using size_type = std::size_t;
+            using wait_policy = WaitPolicy;
+
+        private:
+            table_type &table_;
+            size_type position_;
+            wait_policy policy_;
+
+            void do_wait()
+            {
+                policy_([this]()
+                        { return table_.has_value(position_); },
+                        [this]()
+                        { table_.wait(position_); });
+            }
+
+            /// 当前位置是否为跳过标记 (fixed::table::chunk 留下的空位)
+            bool skipped() const
+            {
+                if constexpr (requires { table_.skipped(position_); })
+                    return table_.skipped(position_);
+                else
+                    return false;
+            }
+
+            void advance()
+            {
+                if constexpr (requires { table_.next(position_); })
+                    position_ = table_.next(position_);
+                else
+                    ++position_;
+            }
+
+        public:
+            cursor(table_type &table, size_type position = 0, wait_policy policy = {})
+                : table_(table), position_(position), policy_(policy)
+            {
+            }
+
+            /// 下一条要读取的数据下标
+            size_type position() const
+            {
+                return position_;
+            }
+
+            void seek(size_type position)
+            {
+                position_ = position;
+            }
+
+            /// 下一条数据是否已经就绪
+            bool ready() const
+            {
+                return table_.has_value(position_);
+            }
+
+            /// 等待并返回下一条数据
+            decltype(auto) next()
+            {
+                this->do_wait();
+                while (this->skipped())
+                {
+                    this->advance();
+                    this->do_wait();
+                }
+
+                decltype(auto) val = table_[position_];
+                this->advance();
+                return val;
+            }
+
+            /// co_await cursor.async_next(reactor) 等待并返回下一条数据, 不阻塞线程; 跳过标记在等待期间跳过
+            auto async_next(async::reactor &reactor)
+            {
+                return table_.async_until(
+                    reactor,
+                    [this]()
+                    {
+                        while (table_.has_value(position_) && this->skipped())
+                            this->advance();
+                        return table_.has_value(position_);
+                    },
+                    [this]() -> decltype(auto)
+                    { return this->next(); });
+            }
+
+            /// 不等待, 对已就绪的数据 (最多 max 个位置) 依次调用 func, 跳过标记不调用, 返回处理条数
+            template <typename Func>
+            size_type poll(size_type max, Func &&func)
+            {
+                // table 能一次统计多条已发布数据时, 不再逐条检查
+                if constexpr (requires { table_.available(position_, max); })
+                {
+                    auto ready = table_.available(position_, max);
+                    size_type count = 0;
+                    for (size_type i = 0; i < ready; ++i)
+                    {
+                        if (!this->skipped())
+                        {
+                            func(table_[position_]);
+                            ++count;
+                        }
+                        this->advance();
+                    }
+                    return count;
+                }
+
+                size_type count = 0;
+                for (size_type i = 0; i < max && table_.has_value(position_); ++i)
+                {
+                    if (!this->skipped())
+                    {
+                        func(table_[position_]);
+                        ++count;
+                    }
+                    this->advance();
+                }
+                return count;
+            }
+
+            /// 至少等待一条数据, 再批量处理已就绪的数据 (最多 max 条), 返回处理条数
+            /// 已就绪的位置全是跳过标记时继续等待, max 不为 0 时返回值不为 0
+            template <typename Func>
+            size_type next_batch(size_type max, Func &&func)
+            {
+                if (max == 0)
+                    return 0;
+
+                for (;;)
+                {
+                    this->do_wait();
+                    if (auto count = this->poll(max, func))
+                        return count;
+                }
+            }
+        };
+    }
+}
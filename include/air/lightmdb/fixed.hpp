@@ -4,8 +4,13 @@
 #include <string_view>
 #include <cstddef>
 #include <limits>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
 
 #include "air/lightmdb/core.hpp"
+#include "air/lightmdb/layout.hpp"
+#include "air/lightmdb/async.hpp"
 
 namespace air
 {
@@ -13,7 +18,8 @@ namespace air
     {
         namespace fixed
         {
-            template <typename T, bool IsLock = true>
+            /// IsLock 为 true 时多个写入者扩容互斥, 为 false 时只能有一个写入者; Producer 为 producer_t::single 时只允许一个写入者
+            template <typename T, bool IsLock = true, typename Layout = layout::packed, producer_t Producer = producer_t::multi>
             class table
             {
             public:
@@ -24,116 +30,307 @@ namespace air
                 using const_reference = const value_type &;
                 using pointer = value_type *;
                 using const_pointer = const value_type *;
+                using layout_type = Layout;
 
             private:
-                struct node
-                {
-                    detail::atomic<bool> is_value;
-                    value_type value;
+                using block = typename Layout::template block<value_type>;
 
-                    node &operator=(const value_type &val)
-                    {
-                        this->value = val;
-                        this->is_value = true;
-                        this->is_value.notify_all();
-                        return *this;
-                    }
+                /// 每个 block 存储的数据条数
+                static constexpr std::size_t slots = block::slots;
+                /// 每条数据在 header.size 中占用的字节数
+                static constexpr std::size_t stride = sizeof(block) / slots;
 
-                    void wait()
-                    {
-                        this->is_value.wait(false);
-                    }
-                };
+                static constexpr bool single = Producer == producer_t::single;
+
+                static_assert((slots & (slots - 1)) == 0, "slots must be a power of 2");
+                static_assert(sizeof(block) % slots == 0, "block size must be a multiple of slots");
 
                 detail::mmap mmap_;
-                node *node_;
 
                 // 本地 capacity
                 std::size_t capacity_;
 
+                // 单写入者的本地写入位置, 每 flush_interval 条数据发布一次到 header.size
+                std::size_t write_;
+
+                // 本地缓存的连续已发布水位 (条数), 之前的位置无需逐条检查
+                std::size_t committed_ = 0;
+
+                /// 容纳 count 条数据所需的字节数
+                static std::size_t bytes(std::size_t count)
+                {
+                    return (count + slots - 1) / slots * sizeof(block);
+                }
+
                 void remmap()
                 {
-                    capacity_ = mmap_.get_header().capacity / sizeof(node);
+                    capacity_ = mmap_.get_header().capacity / sizeof(block) * slots;
                     mmap_.remmap();
-                    node_ = static_cast<node *>(mmap_.get_address());
+                }
+
+                block &at(std::size_t index)
+                {
+                    return *mmap_.template at<block>(index / slots);
+                }
+
+                /// 保证本地映射至少容纳 count 个节点, 必要时扩容
+                void do_recapacity(std::size_t count)
+                {
+                    mmap_.reserve_until(
+                        count * stride, IsLock && !single, [this]()
+                        { return capacity_ * stride; },
+                        [this]()
+                        { this->remmap(); });
                 }
 
                 /// 推入数据
                 std::size_t do_push(const value_type &val, std::size_t index)
                 {
-                    if (index >= capacity_)
+                    this->do_recapacity(index + 1);
+
+                    this->at(index).template store<single>(index, val);
+                    this->do_publish(index, 1);
+
+                    mmap_.count(&detail::stats::pushes);
+                    mmap_.count(&detail::stats::bytes, sizeof(value_type));
+                    return index;
+                }
+
+                /// 批量推入数据, 全部发布后再统一唤醒
+                template <typename InputIt>
+                std::size_t do_push(InputIt first, std::size_t count, std::size_t index)
+                {
+                    this->do_recapacity(index + count);
+
+                    for (std::size_t i = 0; i < count; ++i, ++first)
+                        this->at(index + i).template store<single>(index + i, *first);
+
+                    this->do_publish(index, count);
+
+                    mmap_.count(&detail::stats::pushes, count);
+                    mmap_.count(&detail::stats::bytes, count * sizeof(value_type));
+                    return index;
+                }
+
+                /// 把 [index, index + count) 发布为跳过标记
+                void do_skip(std::size_t index, std::size_t count)
+                {
+                    this->do_recapacity(index + count);
+
+                    for (std::size_t i = 0; i < count; ++i)
+                        this->at(index + i).skip(index + i);
+
+                    this->do_publish(index, count);
+                }
+
+                /// [index, index + count) 发布之后推进水位并唤醒阻塞的读者与 reactor, 批量发布只唤醒一次
+                void do_publish(std::size_t index, std::size_t count)
+                {
+                    // 单写入者在 flush 时推进水位; 只有看到等待者时才 fence 并唤醒, 没有等待者的 push 路径上没有 fence
+                    // 不 fence 时可能看不到刚登记的等待者, 这样的读者最迟在下一次 flush (总是 fence 并唤醒) 时被唤醒
+                    if constexpr (single)
                     {
-                        auto &header = mmap_.get_header();
+                        if (!mmap_.watched())
+                            return;
+                    }
 
-                        if constexpr (IsLock == true)
-                        {
-                            auto flag = header.lock.exchange(true);
+                    // 与 mmap::wait 中 waiters 的自增以及其他写入者推进水位配对, 保证发布数据与检查 waiters/水位不会重排
+                    boost::atomic_thread_fence(boost::memory_order_seq_cst);
 
-                            if (!flag)
-                            {
-                                if (capacity_ == this->capacity())
-                                {
-                                    mmap_.recapacity();
-                                }
+                    if constexpr (!single)
+                        this->do_advance(index, count);
 
-                                header.lock = false;
-                                header.capacity.notify_all();
-                            }
+                    mmap_.notify();
+                }
 
-                            header.capacity.wait(capacity_ * sizeof(node));
-                        }
-                        else
-                        {
-                            mmap_.recapacity();
-                            header.capacity.notify_all();
-                        }
+                /// 只有发布范围覆盖水位的写入者负责推进水位, 其余写入者只读一次 header.committed
+                /// 推进后重新检查水位处的位置, 与在推进期间发布、但看到旧水位的写入者配对
+                void do_advance(std::size_t index, std::size_t count)
+                {
+                    auto begin = mmap_.get_header().committed.load(boost::memory_order_relaxed) / stride;
+                    if (begin < index || begin >= index + count)
+                        return;
 
-                        this->remmap();
+                    for (;;)
+                    {
+                        auto end = begin + this->available(begin, this->max_size() - begin);
+                        if (end == begin)
+                            return;
+
+                        // available 可能重建映射, header 的引用不能跨越它保存
+                        auto expected = begin * stride;
+                        if (!mmap_.get_header().committed.compare_exchange_strong(expected, end * stride))
+                            return;
+
+                        boost::atomic_thread_fence(boost::memory_order_seq_cst);
+                        begin = end;
                     }
+                }
 
-                    node_[index] = val;
-                    return index;
+                /// 连续已发布的数据条数, index 超过本地缓存时才读取 header
+                std::size_t do_committed(std::size_t index)
+                {
+                    if (index >= committed_)
+                        committed_ = mmap_.get_header().committed.load(boost::memory_order_acquire) / stride;
+                    return committed_;
                 }
 
-                /// 读取数据
-                node &do_read(std::size_t index)
+                /// 读取数据, 返回数据所在的 block
+                block &do_read(std::size_t index)
                 {
                     while (index >= capacity_)
                     {
                         auto &header = mmap_.get_header();
-                        header.capacity.wait(capacity_ * sizeof(node));
+                        if (header.capacity == capacity_ * stride)
+                            mmap_.count(&detail::stats::capacity_waits);
+                        header.capacity.wait(capacity_ * stride);
+
+                        this->remmap();
+                    }
+                    return this->at(index);
+                }
+
+                /// 不阻塞的读取, 数据所在区域尚未扩容时返回 nullptr
+                block *try_read(std::size_t index)
+                {
+                    if (index >= capacity_)
+                    {
+                        if (index >= mmap_.get_header().capacity / sizeof(block) * slots)
+                            return nullptr;
 
                         this->remmap();
                     }
-                    return node_[index];
+                    return &this->at(index);
                 }
 
             public:
-                table(std::string_view name, mode_t mode, std::size_t capacity)
-                    : mmap_(name, mode, capacity * sizeof(node))
+                /// 写入者独占的块写入器, 用一次 fetch_add 占用 size 个连续位置后在本地依次填充, 类似 TLAB
+                /// 多个写入者的数据按块交错: 下标顺序不再是全局的 push 顺序, 只保证同一写入者的数据有序
+                /// flush 或析构时未用完的位置发布为跳过标记, 读者不会阻塞在这些位置上 (cursor 自动跳过)
+                /// 写入者在 flush 前崩溃时, 未用完的位置会一直阻塞读者; 不能在线程间共享
+                class chunk
+                {
+                    static_assert(Producer == producer_t::multi, "chunk requires producer_t::multi");
+
+                    table &table_;
+                    std::size_t size_;
+                    std::size_t next_ = 0;
+                    std::size_t end_ = 0;
+
+                public:
+                    chunk(table &table, std::size_t size)
+                        : table_(table), size_(size)
+                    {
+                        if (size == 0)
+                            throw std::runtime_error("chunk size must not be 0");
+                    }
+
+                    chunk(const chunk &) = delete;
+                    chunk &operator=(const chunk &) = delete;
+
+                    ~chunk()
+                    {
+                        this->flush();
+                    }
+
+                    std::size_t push(const value_type &val)
+                    {
+                        if (next_ == end_)
+                        {
+                            next_ = table_.mmap_.get_header().size.fetch_add(size_ * stride) / stride;
+                            end_ = next_ + size_;
+                            table_.do_recapacity(end_);
+                        }
+                        return table_.do_push(val, next_++);
+                    }
+
+                    /// 当前块中剩余的位置数
+                    std::size_t remaining() const
+                    {
+                        return end_ - next_;
+                    }
+
+                    /// 把当前块剩余的位置发布为跳过标记, 下一次 push 重新占用一块
+                    void flush()
+                    {
+                        if (next_ != end_)
+                            table_.do_skip(next_, end_ - next_);
+                        next_ = end_;
+                    }
+                };
+
+                table(std::string_view name, mode_t mode, std::size_t capacity, const options &opts = {})
+                    : mmap_(name, mode, bytes(capacity), detail::check_growth(opts, IsLock && !single), sizeof(block), detail::published_t::committed)
                 {
-                    node_ = static_cast<node *>(mmap_.get_address());
                     capacity_ = this->capacity();
+                    write_ = mmap_.size() / stride;
+                    if (opts.recover)
+                        this->recover();
                 }
 
-                table(std::string_view name, mode_t mode)
-                    : mmap_(name, mode)
+                table(std::string_view name, mode_t mode, const options &opts = {})
+                    : mmap_(name, mode, detail::check_growth(opts, IsLock && !single), detail::published_t::committed)
                 {
-                    node_ = static_cast<node *>(mmap_.get_address());
                     capacity_ = this->capacity();
+                    write_ = mmap_.size() / stride;
+                    if (opts.recover && mmap_.writable())
+                        this->recover();
                 }
 
-                ~table() = default;
+                ~table()
+                {
+                    if constexpr (single)
+                    {
+                        if (write_ > mmap_.size() / stride)
+                            this->flush();
+                    }
+                }
 
                 std::size_t push(const value_type &val)
                 {
-                    auto index = mmap_.get_header().size.fetch_add(sizeof(node));
-                    return this->do_push(val, index / sizeof(node));
+                    if constexpr (single)
+                    {
+                        auto index = write_++;
+                        this->do_push(val, index);
+                        if (write_ % detail::flush_interval == 0)
+                            this->flush();
+                        return index;
+                    }
+
+                    auto index = mmap_.get_header().size.fetch_add(stride);
+                    return this->do_push(val, index / stride);
+                }
+
+                /// 批量推入 count 个数据, 只占用一次 header.size 并且只唤醒一次等待者, 返回第一个数据的下标
+                template <typename InputIt>
+                std::size_t push_n(InputIt first, std::size_t count)
+                {
+                    if (count == 0)
+                        return this->size();
+
+                    if constexpr (single)
+                    {
+                        auto index = write_;
+                        write_ += count;
+                        this->do_push(first, count, index);
+                        if (write_ / detail::flush_interval != index / detail::flush_interval)
+                            this->flush();
+                        return index;
+                    }
+
+                    auto index = mmap_.get_header().size.fetch_add(count * stride);
+                    return this->do_push(first, count, index / stride);
+                }
+
+                template <typename ForwardIt>
+                std::size_t push(ForwardIt first, ForwardIt last)
+                {
+                    return this->push_n(first, static_cast<std::size_t>(std::distance(first, last)));
                 }
 
                 value_type &operator[](std::size_t index)
                 {
-                    return this->do_read(index).value;
+                    return this->do_read(index).value(index);
                 }
 
                 const value_type &operator[](std::size_t index) const
@@ -143,15 +340,58 @@ namespace air
 
                 bool has_value(std::size_t index) const
                 {
-                    if (index < this->size())
-                        return const_cast<table *>(this)->do_read(index).is_value;
-                    else
-                        return false;
+                    if (index < const_cast<table *>(this)->do_committed(index))
+                        return true;
+
+                    auto block = const_cast<table *>(this)->try_read(index);
+                    return block != nullptr && block->has_value(index);
+                }
+
+                /// index 处是否为 chunk 留下的跳过标记, 只在 has_value 返回 true 之后有意义
+                bool skipped(std::size_t index) const
+                {
+                    return const_cast<table *>(this)->do_read(index).skipped(index);
                 }
 
+                /// 从 index 开始连续已发布的数据条数 (包括跳过标记), 最多统计 max 条
+                /// bitmap 布局下每 64 条数据只需一次 load
+                std::size_t available(std::size_t index, std::size_t max) const
+                {
+                    // 水位之前的数据无需逐条检查
+                    auto committed = const_cast<table *>(this)->do_committed(index);
+                    std::size_t count = committed > index ? (std::min)(committed - index, max) : 0;
+                    while (count < max)
+                    {
+                        auto block = const_cast<table *>(this)->try_read(index + count);
+                        auto ready = block != nullptr ? block->ready(index + count) : 0;
+                        if (ready == 0)
+                            break;
+                        count += ready;
+                    }
+                    return (std::min)(count, max);
+                }
+
+                /// 阻塞到 index 处的数据发布, 只读映射同样由写入者唤醒, 见 detail::mmap::wait
                 void wait(std::size_t index) const
                 {
-                    const_cast<table *>(this)->do_read(index).wait();
+                    auto self = const_cast<table *>(this);
+                    self->mmap_.wait([self, index]()
+                                     { return self->has_value(index); });
+                }
+
+                /// 协程等待 ready() 返回 true, co_await 的结果为 resume(); 本 table 有数据发布时由 reactor 检查 ready
+                template <typename Ready, typename Resume>
+                auto async_until(async::reactor &reactor, Ready ready, Resume resume) const
+                {
+                    return reactor.until(const_cast<table *>(this)->mmap_, std::move(ready), std::move(resume));
+                }
+
+                /// co_await table.async_wait(reactor, index) 等待 index 处的数据发布, 不阻塞线程
+                auto async_wait(async::reactor &reactor, std::size_t index) const
+                {
+                    return this->async_until(reactor, [this, index]()
+                                             { return this->has_value(index); },
+                                             []() {});
                 }
 
                 bool empty() const
@@ -159,9 +399,76 @@ namespace air
                     return !this->size();
                 }
 
+                /// 单写入者模式下其他进程看到的 size 可能滞后, 直到写入者 flush
                 std::size_t size() const
                 {
-                    return mmap_.size() / sizeof(node);
+                    if constexpr (single)
+                        return (std::max)(mmap_.size() / stride, write_);
+
+                    return mmap_.size() / stride;
+                }
+
+                /// 连续已发布的数据条数, 之前的数据读者可以直接读取
+                /// 单写入者模式下与 header.size 一起在 flush 时发布
+                std::size_t committed() const
+                {
+                    return const_cast<table *>(this)->mmap_.get_header().committed.load(boost::memory_order_acquire) / stride;
+                }
+
+                /// 崩溃恢复: 从水位扫描到 size, 把已占用但未发布的位置 (崩溃的写入者留下的空洞) 发布为跳过标记
+                /// 只扫描上次水位之后的部分; 调用时不能有其他写入者, 返回空洞个数
+                /// 单写入者崩溃时 header.size 之后可能还有已发布但未 flush 的数据, 或 flush 只写了 size 没写水位;
+                /// 写入位置先越过这些已发布的数据再 flush, 之后的写入不会覆盖读者可能已经读到的数据
+                std::size_t recover()
+                {
+                    if constexpr (single)
+                    {
+                        for (block *val; (val = this->try_read(write_)) != nullptr && val->has_value(write_);)
+                            ++write_;
+                    }
+                    this->flush();
+
+                    std::size_t holes = 0;
+                    auto size = this->size();
+                    for (auto index = this->committed(); index < size; ++index)
+                    {
+                        if (!this->has_value(index))
+                        {
+                            this->do_skip(index, 1);
+                            ++holes;
+                        }
+                    }
+
+                    mmap_.get_header().committed.store(size * stride, boost::memory_order_release);
+                    return holes;
+                }
+
+                /// 单写入者模式下把本地写入位置发布到 header.size 与水位, 多写入者模式下无操作
+                /// 推进水位后唤醒等待水位的刷盘线程, 见 durability_t::group_commit; 单写入者空闲前应调用一次, 见 do_publish
+                void flush()
+                {
+                    if constexpr (single)
+                    {
+                        auto &header = mmap_.get_header();
+                        header.size.store(write_ * stride, boost::memory_order_release);
+                        header.committed.store(write_ * stride, boost::memory_order_release);
+
+                        boost::atomic_thread_fence(boost::memory_order_seq_cst);
+                        mmap_.notify();
+                    }
+                }
+
+                /// 保证调用前写入的数据都已刷盘, 见 options::durability
+                void sync()
+                {
+                    this->flush();
+                    mmap_.sync();
+                }
+
+                /// 已刷盘的数据条数
+                std::size_t durable_size() const
+                {
+                    return mmap_.durable_size() / stride;
                 }
 
                 std::size_t max_size() const
@@ -171,12 +478,35 @@ namespace air
 
                 std::size_t capacity() const
                 {
-                    return mmap_.capacity() / sizeof(node);
+                    return mmap_.capacity() / sizeof(block) * slots;
                 }
 
                 void shrink_to_fit()
                 {
-                    mmap_.shrink_to_fit();
+                    this->flush();
+                    mmap_.shrink_to_fit(bytes(this->size()));
+                }
+
+                /// 对下标 [first, last) 的数据调用 madvise
+                void advise(std::size_t first, std::size_t last, advice_t advice)
+                {
+                    if (first >= last)
+                        return;
+                    mmap_.advise(first / slots * sizeof(block), bytes(last) - first / slots * sizeof(block), advice);
+                }
+
+                /// 释放下标 index 之前的数据占用的磁盘空间与内存, 下标与文件大小不变, 见 detail::mmap::discard
+                /// 只释放完整的 block, 调用者保证不再读取这些数据; 文件系统不支持打洞时返回 false
+                bool discard_before(std::size_t index)
+                {
+                    this->flush();
+                    return mmap_.discard(index / slots * sizeof(block));
+                }
+
+                /// 已释放的数据条数, 之前的下标不能再读取
+                std::size_t discarded() const
+                {
+                    return mmap_.discarded() / sizeof(block) * slots;
                 }
 
                 const std::string &name() const
@@ -0,0 +1,487 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "air/lightmdb/core.hpp"
+#include "air/lightmdb/async.hpp"
+
+namespace air
+{
+    namespace lightmdb
+    {
+        /// 单文件日志模式: 每条数据前是一个帧头 (长度 + 提交标志), 帧连续存放在同一个映射中
+        /// 写入只需要一次 fetch_add, 读者按帧顺序遍历; 数据以字节偏移为下标
+        namespace framed
+        {
+            /// Interval 为稀疏索引的间隔, 每 Interval 条数据记录一次偏移, 同一文件必须使用相同的 Interval
+            template <bool IsLock = true, std::size_t Interval = 1024>
+            class table
+            {
+            public:
+                using size_type = std::size_t;
+                using difference_type = std::ptrdiff_t;
+
+                static_assert(Interval != 0, "interval must not be 0");
+
+            private:
+                /// 帧头, 帧按 8 字节对齐
+                struct frame
+                {
+                    /// 0 未提交, 1 已提交, 2 跳过 (崩溃恢复时发布的未提交帧, 数据无效)
+                    detail::atomic<std::uint32_t> committed;
+                    /// 数据字节数, 不含帧头与对齐填充
+                    std::uint32_t size;
+                };
+
+                static constexpr size_type alignment = sizeof(frame);
+
+                detail::mmap mmap_;
+                // 稀疏索引, 第 k 项为第 k * Interval 条数据的偏移, header.lock 作为构建锁
+                // 构建中崩溃会留下锁, 之后的 index 直接返回, 由 options::recover 清除
+                detail::mmap index_;
+
+                // 本地 capacity
+                size_type capacity_;
+
+                // 可写映射才构建稀疏索引
+                bool writable_;
+                // 本对象提交的帧数, 每 Interval 帧扩展一次稀疏索引
+                size_type commits_ = 0;
+
+                /// size 字节数据占用的帧字节数
+                static size_type bytes(size_type size)
+                {
+                    return sizeof(frame) + (size + alignment - 1) / alignment * alignment;
+                }
+
+                static const options &check(const options &opts)
+                {
+                    if (opts.segment != 0)
+                        throw std::runtime_error("framed table does not support segment");
+
+                    return detail::check_growth(opts, IsLock);
+                }
+
+                /// 稀疏索引只沿用存储后端
+                static options index_options(const options &opts)
+                {
+                    options index;
+                    index.backend = opts.backend;
+                    return index;
+                }
+
+                static bool is_writable(mode_t mode)
+                {
+                    return mode == mode_t::create_only || mode == mode_t::open_or_create || mode == mode_t::read_write;
+                }
+
+                void remmap()
+                {
+                    capacity_ = mmap_.get_header().capacity;
+                    mmap_.remmap();
+                }
+
+                /// 占用 size 字节数据所需的帧, 返回帧偏移
+                size_type do_claim(size_type size)
+                {
+                    if (size > (std::numeric_limits<std::uint32_t>::max)())
+                        throw std::runtime_error("data larger than frame");
+
+                    return mmap_.get_header().size.fetch_add(bytes(size));
+                }
+
+                /// 保证 [index, index + size) 已映射, 返回写入地址
+                void *do_reserve(size_type size, size_type index)
+                {
+                    mmap_.reserve_until(
+                        index + size, IsLock, [this]()
+                        { return capacity_; },
+                        [this]()
+                        { this->remmap(); });
+
+                    return mmap_.template at<char>(index);
+                }
+
+                void *do_read(size_type index, size_type size)
+                {
+                    while (index + size > capacity_)
+                    {
+                        auto &header = mmap_.get_header();
+                        if (header.capacity == capacity_)
+                            mmap_.count(&detail::stats::capacity_waits);
+                        header.capacity.wait(capacity_);
+
+                        this->remmap();
+                    }
+                    return mmap_.template at<char>(index);
+                }
+
+                frame &at(size_type index)
+                {
+                    return *static_cast<frame *>(this->do_read(index, sizeof(frame)));
+                }
+
+                /// 不阻塞的读取, 帧头所在区域尚未扩容时返回 nullptr
+                frame *try_at(size_type index)
+                {
+                    if (index + sizeof(frame) > capacity_)
+                    {
+                        if (index + sizeof(frame) > mmap_.get_header().capacity)
+                            return nullptr;
+
+                        this->remmap();
+                    }
+                    return reinterpret_cast<frame *>(mmap_.template at<char>(index));
+                }
+
+                /// 只有提交的帧恰好位于水位的写入者负责沿连续已提交的帧推进 header.committed
+                /// 推进后重新检查水位处的帧, 与在推进期间提交、但看到旧水位的写入者配对, 见 fixed::table::do_advance
+                void do_advance(size_type index)
+                {
+                    auto begin = mmap_.get_header().committed.load(boost::memory_order_relaxed);
+                    if (begin != index)
+                        return;
+
+                    for (;;)
+                    {
+                        auto end = begin;
+                        while (this->has_value(end))
+                            end = this->next(end);
+                        if (end == begin)
+                            return;
+
+                        // has_value 可能重建映射, header 的引用不能跨越它保存
+                        auto expected = begin;
+                        if (!mmap_.get_header().committed.compare_exchange_strong(expected, end))
+                            return;
+
+                        boost::atomic_thread_fence(boost::memory_order_seq_cst);
+                        begin = end;
+                    }
+                }
+
+                /// 发布帧, 推进水位并唤醒阻塞的读者
+                size_type do_commit(size_type index)
+                {
+                    auto &val = this->at(index);
+                    auto size = val.size;
+                    val.committed.store(1, boost::memory_order_release);
+
+                    // 与 mmap::wait 中 waiters 的自增以及其他写入者推进水位配对, 没有等待者时不写 header
+                    boost::atomic_thread_fence(boost::memory_order_seq_cst);
+                    this->do_advance(index);
+                    mmap_.notify();
+
+                    mmap_.count(&detail::stats::pushes);
+                    mmap_.count(&detail::stats::bytes, size);
+
+                    // 写入者负责扩展稀疏索引, 只读映射的 seek 也只需从索引出发遍历少量帧
+                    if (++commits_ % Interval == 0)
+                        this->index();
+                    return index;
+                }
+
+                /// 已发布的索引条目数
+                size_type entries()
+                {
+                    return index_.size() / sizeof(size_type);
+                }
+
+                size_type &entry(size_type k)
+                {
+                    if ((k + 1) * sizeof(size_type) > index_.capacity())
+                        index_.remmap();
+                    return *index_.template at<size_type>(k);
+                }
+
+                /// 写入第 k 项索引并发布, 调用者持有构建锁
+                void do_append(size_type k, size_type offset)
+                {
+                    while ((k + 1) * sizeof(size_type) > index_.get_header().capacity)
+                        index_.recapacity();
+
+                    this->entry(k) = offset;
+                    index_.get_header().size.store((k + 1) * sizeof(size_type), boost::memory_order_release);
+                }
+
+            public:
+                /// reserve 返回的写入句柄
+                struct reservation
+                {
+                    void *data;
+                    size_type offset;
+                    size_type size;
+                };
+
+                table(const std::string &name, mode_t mode, size_type capacity, const options &opts = {})
+                    : mmap_(name, mode, capacity, check(opts), 1, detail::published_t::committed),
+                      index_(name + "x", mode, sizeof(size_type) * 64, index_options(opts), sizeof(size_type)),
+                      writable_(is_writable(mode))
+                {
+                    capacity_ = this->capacity();
+                    if (opts.recover)
+                        this->recover();
+                }
+
+                table(const std::string &name, mode_t mode, const options &opts = {})
+                    : mmap_(name, mode, check(opts), detail::published_t::committed), index_(name + "x", mode, index_options(opts)), writable_(is_writable(mode))
+                {
+                    capacity_ = this->capacity();
+                    if (opts.recover && writable_)
+                        this->recover();
+                }
+
+                ~table() = default;
+
+                /// 写入一帧, 返回帧偏移
+                size_type push(const void *val, size_type size)
+                {
+                    auto index = this->do_claim(size);
+                    auto data = static_cast<frame *>(this->do_reserve(bytes(size), index));
+                    data->size = static_cast<std::uint32_t>(size);
+                    memcpy(reinterpret_cast<char *>(data + 1), val, size);
+                    return this->do_commit(index);
+                }
+
+                /// 在映射区内预留 size 字节, 调用者直接写入 data 后再 commit
+                /// 已预留未提交的帧会阻塞其后的顺序读者, data 只在本对象下一次 reserve/push 之前有效
+                reservation reserve(size_type size)
+                {
+                    auto index = this->do_claim(size);
+                    auto data = static_cast<frame *>(this->do_reserve(bytes(size), index));
+                    data->size = static_cast<std::uint32_t>(size);
+                    return {data + 1, index, size};
+                }
+
+                /// 发布 reserve 得到的数据, 返回帧偏移
+                size_type commit(const reservation &val)
+                {
+                    return this->do_commit(val.offset);
+                }
+
+                /// 偏移 index 处的帧已提交或被跳过
+                bool has_value(size_type index) const
+                {
+                    auto val = const_cast<table *>(this)->try_at(index);
+                    return val != nullptr && val->committed.load(boost::memory_order_acquire) != 0;
+                }
+
+                /// 偏移 index 处的帧是否为 recover 发布的跳过帧, 要求 has_value(index)
+                bool skipped(size_type index) const
+                {
+                    return const_cast<table *>(this)->at(index).committed.load(boost::memory_order_relaxed) == 2;
+                }
+
+                /// 读取偏移 index 处已提交的帧
+                std::pair<void *, size_type> operator[](size_type index)
+                {
+                    auto size = this->at(index).size;
+                    return {static_cast<char *>(this->do_read(index, bytes(size))) + sizeof(frame), size};
+                }
+
+                std::pair<const void *, size_type> operator[](size_type index) const
+                {
+                    return const_cast<table *>(this)->operator[](index);
+                }
+
+                /// 阻塞到偏移 index 处的帧提交, 只读映射同样由写入者唤醒, 见 detail::mmap::wait
+                void wait(size_type index) const
+                {
+                    auto self = const_cast<table *>(this);
+                    self->mmap_.wait([self, index]()
+                                     { return self->has_value(index); });
+                }
+
+                /// 协程等待 ready() 返回 true, co_await 的结果为 resume(); 本 table 有数据发布时由 reactor 检查 ready
+                template <typename Ready, typename Resume>
+                auto async_until(async::reactor &reactor, Ready ready, Resume resume) const
+                {
+                    return reactor.until(const_cast<table *>(this)->mmap_, std::move(ready), std::move(resume));
+                }
+
+                /// co_await table.async_wait(reactor, index) 等待偏移 index 处的帧提交, 不阻塞线程
+                auto async_wait(async::reactor &reactor, size_type index) const
+                {
+                    return this->async_until(reactor, [this, index]()
+                                             { return this->has_value(index); },
+                                             []() {});
+                }
+
+                /// 偏移 index 处已提交帧之后的下一帧偏移
+                size_type next(size_type index) const
+                {
+                    return index + bytes(const_cast<table *>(this)->at(index).size);
+                }
+
+                /// 把稀疏索引推进到连续已提交的数据末尾, 返回已建立索引的条目数
+                /// 只有可写映射会构建, 其他进程正在构建时直接返回; 写入者每提交 Interval 帧自动调用一次
+                size_type index()
+                {
+                    if (!writable_ || index_.get_header().lock.exchange(true))
+                        return this->entries();
+
+                    // 扩容会重建映射, header 的引用不能跨越 do_append 保存
+                    auto count = this->entries();
+                    if (count == 0)
+                    {
+                        // 第 0 条数据总在偏移 0
+                        this->do_append(0, 0);
+                        count = 1;
+                    }
+
+                    for (auto offset = this->entry(count - 1);; ++count)
+                    {
+                        // 向后走 Interval 帧, 中途遇到未提交的帧则停止
+                        size_type i = 0;
+                        for (; i < Interval && this->has_value(offset); ++i)
+                            offset = this->next(offset);
+                        if (i != Interval)
+                            break;
+
+                        this->do_append(count, offset);
+                    }
+
+                    index_.get_header().lock = false;
+                    return count;
+                }
+
+                /// 第 n 条数据的帧偏移, 第 n 条数据已建立索引时从稀疏索引出发最多遍历 Interval - 1 帧
+                /// 写入者每提交 Interval 帧扩展一次索引, 只读映射的索引最多落后于连续已提交的数据约 写入者数 * Interval 帧
+                /// 会等待第 n 条数据之前的数据全部提交
+                size_type seek(size_type n)
+                {
+                    auto k = n / Interval;
+                    if (k >= this->entries())
+                        this->index();
+
+                    auto count = this->entries();
+                    if (count == 0)
+                        k = 0;
+                    else
+                        k = (std::min)(k, count - 1);
+
+                    size_type offset = count == 0 ? 0 : this->entry(k);
+                    for (auto i = k * Interval; i < n; ++i)
+                    {
+                        this->wait(offset);
+                        offset = this->next(offset);
+                    }
+                    return offset;
+                }
+
+                /// 连续已提交的字节数, 之前的帧都已提交或被跳过
+                size_type committed() const
+                {
+                    return const_cast<table *>(this)->mmap_.get_header().committed.load(boost::memory_order_acquire);
+                }
+
+                /// 崩溃恢复: 清除构建锁, 从水位遍历到 size, 把已占用但未提交的帧发布为跳过帧, 返回跳过的帧数
+                /// 在写入帧长之前崩溃的写入者留下的区域全为 0, 按长度为 0 的帧逐个跳过, 最终对齐到下一帧
+                /// 占用后未来得及扩容的部分, 以及帧长越过 size 的帧 (帧头损坏) 之后的数据被截断; 调用时不能有其他写入者
+                size_type recover()
+                {
+                    index_.get_header().lock = false;
+
+                    size_type holes = 0;
+                    auto size = (std::min)(this->size(), static_cast<size_type>(mmap_.get_header().capacity.load()));
+                    auto offset = this->committed();
+                    while (offset < size)
+                    {
+                        auto &val = this->at(offset);
+                        if (val.committed.load(boost::memory_order_acquire) == 0)
+                        {
+                            if (offset + bytes(val.size) > size)
+                            {
+                                size = offset;
+                                break;
+                            }
+                            val.committed.store(2, boost::memory_order_release);
+                            ++holes;
+                        }
+                        offset = this->next(offset);
+                    }
+
+                    mmap_.get_header().size.store(size, boost::memory_order_release);
+                    mmap_.get_header().committed.store(size, boost::memory_order_release);
+                    this->index();
+                    return holes;
+                }
+
+                bool empty() const
+                {
+                    return mmap_.size() == 0;
+                }
+
+                /// 已占用的字节数, 即下一帧的偏移
+                size_type size() const
+                {
+                    return mmap_.size();
+                }
+
+                /// 保证调用前提交的帧都已刷盘, 见 options::durability; 稀疏索引可以重建, 不刷盘
+                void sync()
+                {
+                    mmap_.sync();
+                }
+
+                /// 已刷盘的字节数
+                size_type durable_size() const
+                {
+                    return mmap_.durable_size();
+                }
+
+                size_type max_size() const
+                {
+                    return mmap_.max_size();
+                }
+
+                size_type capacity() const
+                {
+                    return mmap_.capacity();
+                }
+
+                void shrink_to_fit()
+                {
+                    mmap_.shrink_to_fit();
+                }
+
+                /// 对偏移 [first, last) 的帧调用 madvise
+                void advise(size_type first, size_type last, advice_t advice)
+                {
+                    if (first < last)
+                        mmap_.advise(first, last - first, advice);
+                }
+
+                /// 释放帧偏移 offset 之前的数据占用的磁盘空间与内存, 帧偏移不变, 见 detail::mmap::discard
+                /// 稀疏索引从最后一项向后遍历帧来扩展, 因此只释放到最后一项之前; 稀疏索引本身很小, 不释放
+                bool discard_before(size_type offset)
+                {
+                    auto count = this->index();
+                    if (count == 0)
+                        return true;
+                    return mmap_.discard((std::min)(offset, this->entry(count - 1)));
+                }
+
+                /// 已释放的字节数, 之前的帧不能再读取
+                size_type discarded() const
+                {
+                    return mmap_.discarded();
+                }
+
+                std::pair<const std::string &, const std::string &> name() const
+                {
+                    return {mmap_.name(), index_.name()};
+                }
+            };
+        }
+    }
+}
\ No newline at end of file
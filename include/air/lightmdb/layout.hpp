@@ -0,0 +1,192 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "air/lightmdb/core.hpp"
+
+namespace air
+{
+    namespace lightmdb
+    {
+        /// fixed::table 的存储布局, 每个布局以 block 为单位存储 slots 个数据
+        /// 各方法的参数为数据在 table 中的下标 index, 在 block 中的位置为 index % slots
+        /// 位置可以发布为数据, 也可以发布为跳过标记 (skip), 跳过的位置 has_value 为 true 但没有数据
+        /// 布局只负责发布标志, 阻塞等待与唤醒由 table 通过 header.signal 统一完成
+        namespace layout
+        {
+            /// 发布标志与数据相邻, 每个 block 一条数据 (默认布局)
+            struct packed
+            {
+                template <typename T>
+                struct block
+                {
+                    static constexpr std::size_t slots = 1;
+
+                    /// 0 未发布, 1 数据, 2 跳过
+                    detail::atomic<std::uint8_t> state;
+                    T data;
+
+                    T &value(std::size_t)
+                    {
+                        return data;
+                    }
+
+                    bool has_value(std::size_t) const
+                    {
+                        return state.load(boost::memory_order_acquire) != 0;
+                    }
+
+                    bool skipped(std::size_t) const
+                    {
+                        return state.load(boost::memory_order_acquire) == 2;
+                    }
+
+                    /// 从 index 开始在本 block 中连续已发布的数据条数
+                    std::size_t ready(std::size_t index) const
+                    {
+                        return this->has_value(index) ? 1 : 0;
+                    }
+
+                    /// 写入数据并发布, 不唤醒等待者; Single 表示只有一个写入者
+                    template <bool Single = false>
+                    void store(std::size_t, const T &val)
+                    {
+                        data = val;
+                        state.store(1, boost::memory_order_release);
+                    }
+
+                    /// 发布为跳过标记, 不唤醒等待者
+                    void skip(std::size_t)
+                    {
+                        state.store(2, boost::memory_order_release);
+                    }
+                };
+            };
+
+            /// 与 packed 相同, 但每条数据按缓存行对齐填充, 相邻数据的读写不会共享缓存行
+            struct aligned
+            {
+                template <typename T>
+                struct alignas(detail::cache_line) block : packed::block<T>
+                {
+                };
+            };
+
+            /// 每 64 条数据为一组, 每个位置的序号集中存放在数据之前 (Vyukov 有界队列的 per-slot sequence)
+            /// 序号为 (index + 1) << 1, 最低位为跳过标记; 只有序号恰好等于本下标时才算已发布,
+            /// 残留的其他下标 (例如复用的文件) 的序号不会被误认为已发布
+            /// 发布与轮询只访问序号所在的缓存行, 不与数据争用
+            struct sequence
+            {
+                template <typename T>
+                struct alignas(detail::cache_line) block
+                {
+                    static constexpr std::size_t slots = 64;
+
+                    detail::atomic<std::uint64_t> sequence[slots];
+                    T data[slots];
+
+                    /// index 发布为数据 (skip 为 false) 或跳过标记时的序号
+                    static constexpr std::uint64_t stamp(std::size_t index, bool skip = false)
+                    {
+                        return (std::uint64_t(index) + 1) << 1 | std::uint64_t(skip);
+                    }
+
+                    T &value(std::size_t index)
+                    {
+                        return data[index % slots];
+                    }
+
+                    bool has_value(std::size_t index) const
+                    {
+                        return (sequence[index % slots].load(boost::memory_order_acquire) | 1) == stamp(index, true);
+                    }
+
+                    bool skipped(std::size_t index) const
+                    {
+                        return sequence[index % slots].load(boost::memory_order_acquire) == stamp(index, true);
+                    }
+
+                    std::size_t ready(std::size_t index) const
+                    {
+                        auto count = index;
+                        auto end = index - index % slots + slots;
+                        while (count < end && this->has_value(count))
+                            ++count;
+                        return count - index;
+                    }
+
+                    template <bool Single = false>
+                    void store(std::size_t index, const T &val)
+                    {
+                        data[index % slots] = val;
+                        sequence[index % slots].store(stamp(index), boost::memory_order_release);
+                    }
+
+                    void skip(std::size_t index)
+                    {
+                        sequence[index % slots].store(stamp(index, true), boost::memory_order_release);
+                    }
+                };
+            };
+
+            /// 每 64 条数据共用一个 64 位发布位图, 读者一次 load 即可检查整组数据
+            struct bitmap
+            {
+                template <typename T>
+                struct alignas(detail::cache_line) block
+                {
+                    static constexpr std::size_t slots = 64;
+
+                    detail::atomic<std::uint64_t> bits;
+                    /// 跳过标记位图, 先于 bits 中对应的位写入
+                    detail::atomic<std::uint64_t> skips;
+                    T data[slots];
+
+                    T &value(std::size_t index)
+                    {
+                        return data[index % slots];
+                    }
+
+                    bool has_value(std::size_t index) const
+                    {
+                        return (bits.load(boost::memory_order_acquire) >> index % slots) & 1;
+                    }
+
+                    /// 只在 has_value 返回 true 之后有意义
+                    bool skipped(std::size_t index) const
+                    {
+                        return (skips.load(boost::memory_order_acquire) >> index % slots) & 1;
+                    }
+
+                    std::size_t ready(std::size_t index) const
+                    {
+                        return std::countr_zero(~(bits.load(boost::memory_order_acquire) >> index % slots));
+                    }
+
+                    template <bool Single = false>
+                    void store(std::size_t index, const T &val)
+                    {
+                        auto slot = index % slots;
+                        data[slot] = val;
+
+                        // 只有一个写入者时位图不会被并发修改, 用 release store 代替 RMW
+                        if constexpr (Single)
+                            bits.store(bits.load(boost::memory_order_relaxed) | (std::uint64_t(1) << slot), boost::memory_order_release);
+                        else
+                            bits.fetch_or(std::uint64_t(1) << slot, boost::memory_order_release);
+                    }
+
+                    void skip(std::size_t index)
+                    {
+                        auto slot = index % slots;
+                        skips.fetch_or(std::uint64_t(1) << slot, boost::memory_order_relaxed);
+                        bits.fetch_or(std::uint64_t(1) << slot, boost::memory_order_release);
+                    }
+                };
+            };
+        }
+    }
+}
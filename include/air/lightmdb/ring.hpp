@@ -0,0 +1,466 @@
+#pragma once
+
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "air/lightmdb/core.hpp"
+
+namespace air
+{
+    namespace lightmdb
+    {
+        /// 环形模式: 容量固定, 创建后不再扩容与重新映射, 写入者绕回覆盖最旧的数据
+        /// 适合只关心最近数据的高频遥测, 文件大小与内存占用恒定; 放在 /dev/shm 上即为纯共享内存队列
+        /// 下标为从 0 开始的绝对序号, header.size 为已占用的序号数
+        namespace ring
+        {
+            /// 读取结果
+            enum class status_t : int8_t
+            {
+                ok = 0,
+                /// 数据尚未发布
+                pending,
+                /// 数据已被后一圈的写入覆盖, 读者需要重新定位到 oldest
+                lapped
+            };
+
+            /// 检查 open_or_create 打开的已有环与请求的容量 (字节数) 一致后返回 capacity
+            /// 环的下标按容量取模, 已有环扩容只改变本进程的容量, 其他进程仍按旧的容量读写, 因此不允许改变容量
+            inline std::size_t check_capacity(std::string_view name, mode_t mode, std::size_t capacity, const options &opts)
+            {
+                if (mode != mode_t::open_or_create || !detail::backend_exists(name, opts.backend))
+                    return capacity;
+
+                // 只读映射不启动后台线程
+                options stored;
+                stored.backend = opts.backend;
+                if (detail::mmap(name, mode_t::read_only, stored).capacity() != capacity)
+                    throw std::runtime_error("ring capacity differs from existing " + std::string(name));
+
+                return capacity;
+            }
+
+            /// 定长数据的环形 table, 容量为 2 的幂
+            /// 每个位置带有序号 seq: 2 * index + 1 表示正在写入, 2 * index + 2 表示第 index 条数据已发布
+            /// 读者按 seqlock 方式复制数据后再检查 seq, 以此判断是否被套圈
+            template <typename T>
+            class table
+            {
+            public:
+                using value_type = T;
+                using size_type = std::size_t;
+                using difference_type = std::ptrdiff_t;
+
+                static_assert(std::is_trivially_copyable_v<T>, "ring table requires trivially copyable type");
+
+            private:
+                struct slot
+                {
+                    detail::atomic<std::uint64_t> seq;
+                    T data;
+                };
+
+                detail::mmap mmap_;
+                // 容量固定, 构造后不变
+                size_type capacity_;
+                size_type mask_;
+
+                static std::uint64_t published(size_type index)
+                {
+                    return 2 * std::uint64_t(index) + 2;
+                }
+
+                static const options &check(const options &opts)
+                {
+                    if (opts.segment != 0)
+                        throw std::runtime_error("ring table does not support segment");
+                    if (opts.growth_threshold != 0)
+                        throw std::runtime_error("ring table does not grow");
+
+                    return opts;
+                }
+
+                void init()
+                {
+                    capacity_ = mmap_.capacity() / sizeof(slot);
+                    if (capacity_ == 0 || (capacity_ & (capacity_ - 1)) != 0)
+                        throw std::runtime_error("ring capacity must be a power of 2");
+                    mask_ = capacity_ - 1;
+                }
+
+                slot &at(size_type index)
+                {
+                    return *mmap_.template at<slot>(index & mask_);
+                }
+
+            public:
+                /// capacity 为数据条数, 必须是 2 的幂; open_or_create 打开已有的环时容量必须与创建时相同
+                table(std::string_view name, mode_t mode, size_type capacity, const options &opts = {})
+                    : mmap_(name, mode, check_capacity(name, mode, capacity * sizeof(slot), opts), check(opts), sizeof(slot))
+                {
+                    init();
+                }
+
+                table(std::string_view name, mode_t mode, const options &opts = {})
+                    : mmap_(name, mode, check(opts))
+                {
+                    init();
+                }
+
+                /// 写入一条数据, 返回其序号; 同一位置上一圈的写入完成之前会等待
+                /// 写入者在写入中途崩溃时, 之后绕回到该位置的写入者会一直等待
+                size_type push(const value_type &val)
+                {
+                    auto index = mmap_.get_header().size.fetch_add(1);
+                    auto &s = this->at(index);
+
+                    // 两个写入者不能同时写入同一位置, 等待上一圈发布
+                    auto prev = index < capacity_ ? 0 : published(index - capacity_);
+                    mmap_.wait([&]()
+                               { return s.seq.load(boost::memory_order_acquire) == prev; });
+
+                    s.seq.store(published(index) - 1, boost::memory_order_relaxed);
+                    boost::atomic_thread_fence(boost::memory_order_release);
+                    memcpy(&s.data, &val, sizeof(value_type));
+                    s.seq.store(published(index), boost::memory_order_release);
+
+                    // 与 mmap::wait 中 waiters 的自增配对, 没有等待者时不写 header
+                    boost::atomic_thread_fence(boost::memory_order_seq_cst);
+                    mmap_.notify();
+
+                    mmap_.count(&detail::stats::pushes);
+                    mmap_.count(&detail::stats::bytes, sizeof(value_type));
+                    return index;
+                }
+
+                /// 复制第 index 条数据到 val, 只有返回 ok 时 val 有效
+                status_t read(size_type index, value_type &val) const
+                {
+                    auto &s = const_cast<table *>(this)->at(index);
+                    auto seq = s.seq.load(boost::memory_order_acquire);
+                    if (seq < published(index))
+                        return status_t::pending;
+                    if (seq > published(index))
+                        return status_t::lapped;
+
+                    memcpy(&val, &s.data, sizeof(value_type));
+
+                    // 复制期间被后一圈的写入者改写时 seq 会改变
+                    boost::atomic_thread_fence(boost::memory_order_acquire);
+                    if (s.seq.load(boost::memory_order_relaxed) != seq)
+                        return status_t::lapped;
+                    return status_t::ok;
+                }
+
+                bool has_value(size_type index) const
+                {
+                    auto &s = const_cast<table *>(this)->at(index);
+                    return s.seq.load(boost::memory_order_acquire) >= published(index);
+                }
+
+                /// 等待第 index 条数据发布或被覆盖; seq 为 64 位, 读者阻塞在 header.signal 上, 见 detail::mmap::wait
+                void wait(size_type index) const
+                {
+                    const_cast<table *>(this)->mmap_.wait([this, index]()
+                                                          { return this->has_value(index); });
+                }
+
+                /// 仍可能位于环中的最旧数据的序号, 被套圈的读者从这里继续
+                size_type oldest() const
+                {
+                    auto size = this->size();
+                    return size > capacity_ ? size - capacity_ : 0;
+                }
+
+                bool empty() const
+                {
+                    return this->size() == 0;
+                }
+
+                /// 已占用的序号数, 即下一条数据的序号
+                size_type size() const
+                {
+                    return mmap_.size();
+                }
+
+                size_type capacity() const
+                {
+                    return capacity_;
+                }
+
+                const std::string &name() const
+                {
+                    return mmap_.name();
+                }
+            };
+
+            /// 变长数据的环形 table: 数据字节写入固定大小的数据环, 偏移与长度写入 table 形式的索引环 (name + "i")
+            /// 数据环被后续写入占用后, 读者通过比较已占用字节数判断数据是否被覆盖
+            /// 每条数据按 8 字节对齐占用数据环; 数据环之后是每 8 字节一个的提交戳, 写完的数据在起点处记录结束偏移
+            /// 写入者各自记录提交戳后不互相等待, header.committed (连续已写完的字节数) 由位于水位处的写入者推进
+            class variable_table
+            {
+            public:
+                using size_type = std::size_t;
+                using difference_type = std::ptrdiff_t;
+
+            private:
+                /// 数据的绝对字节偏移与长度
+                struct record
+                {
+                    std::uint64_t offset;
+                    std::uint64_t size;
+                };
+
+                /// 数据在数据环中的对齐, 也是提交戳的粒度
+                static constexpr size_type align = 8;
+                using stamp = detail::atomic<std::uint64_t>;
+
+                table<record> index_;
+                detail::mmap mmap_;
+                // 数据环字节数
+                size_type capacity_;
+
+                static const options &check(const options &opts)
+                {
+                    if (opts.segment != 0)
+                        throw std::runtime_error("ring table does not support segment");
+                    if (opts.growth_threshold != 0)
+                        throw std::runtime_error("ring table does not grow");
+
+                    return opts;
+                }
+
+                /// 容量为 capacity 字节的数据环与其提交戳共占用的字节数
+                static size_type bytes(size_type capacity)
+                {
+                    if (capacity == 0 || capacity % align != 0)
+                        throw std::runtime_error("ring data capacity must be a multiple of 8");
+                    return capacity + capacity / align * sizeof(stamp);
+                }
+
+                void init()
+                {
+                    capacity_ = mmap_.capacity() / (align + sizeof(stamp)) * align;
+                    if (bytes(capacity_) != mmap_.capacity())
+                        throw std::runtime_error("ring data capacity must be a multiple of 8");
+                }
+
+                char *data()
+                {
+                    return static_cast<char *>(mmap_.get_address());
+                }
+
+                /// 绝对偏移 offset 处的提交戳; 写入者写完 [offset, end) 后记录 end
+                /// 之前各圈在同一位置记录的结束偏移都不超过 offset, 大于 offset 即为本圈已写完的数据
+                stamp &at(size_type offset)
+                {
+                    return reinterpret_cast<stamp *>(this->data() + capacity_)[offset % capacity_ / align];
+                }
+
+                /// 只有提交位置恰好是水位的写入者负责推进水位, 推进后重新检查水位处的提交戳
+                /// 与写入者记录提交戳, seq_cst fence, 检查水位配对, 不会两边都错过
+                void do_advance(size_type offset)
+                {
+                    auto &h = mmap_.get_header();
+                    auto begin = h.committed.load(boost::memory_order_relaxed);
+                    if (begin != offset)
+                        return;
+
+                    for (;;)
+                    {
+                        auto end = begin;
+                        for (std::uint64_t next; (next = this->at(end).load(boost::memory_order_acquire)) > end;)
+                            end = next;
+                        if (end == begin)
+                            return;
+
+                        auto expected = begin;
+                        if (!h.committed.compare_exchange_strong(expected, end))
+                            return;
+
+                        boost::atomic_thread_fence(boost::memory_order_seq_cst);
+                        begin = end;
+                    }
+                }
+
+            public:
+                /// capacity 为数据环字节数 (8 的倍数), index_capacity 为索引环条数 (2 的幂); open_or_create 打开已有的环时两者必须与创建时相同
+                variable_table(const std::string &name, mode_t mode, size_type capacity, size_type index_capacity, const options &opts = {})
+                    : index_(name + "i", mode, index_capacity, opts), mmap_(name, mode, check_capacity(name, mode, bytes(capacity), opts), check(opts), 1, detail::published_t::committed)
+                {
+                    init();
+                }
+
+                variable_table(const std::string &name, mode_t mode, const options &opts = {})
+                    : index_(name + "i", mode, opts), mmap_(name, mode, check(opts), detail::published_t::committed)
+                {
+                    init();
+                }
+
+                /// 写入 size 字节数据, 返回其序号; 数据在环尾绕回时分两段写入
+                /// 与 table::push 相同, 复制前等待上一圈覆盖 [offset, offset + size) 的写入者写完, 被套圈的慢写入者不会改写新数据
+                /// 写完后记录提交戳, 不等待之前占用的写入者; 写入者在写入中途崩溃时水位停止推进, 一圈之后的写入者会一直等待
+                size_type push(const void *val, size_type size)
+                {
+                    // 空数据也占用一个对齐单位, 保证每条数据有自己的提交戳
+                    auto occupied = (std::max)((size + align - 1) / align * align, align);
+                    if (occupied > capacity_)
+                        throw std::runtime_error("data larger than ring");
+
+                    auto &h = mmap_.get_header();
+                    auto offset = h.size.fetch_add(occupied);
+                    auto begin = offset % capacity_;
+
+                    // 上一圈 [offset - capacity, offset + occupied - capacity) 的写入者都在本写入者之前占用
+                    if (offset + occupied > capacity_)
+                        mmap_.wait([&]()
+                                   { return h.committed.load(boost::memory_order_acquire) >= offset + occupied - capacity_; });
+
+                    auto first = (std::min)(size, capacity_ - begin);
+                    memcpy(this->data() + begin, val, first);
+                    memcpy(this->data(), static_cast<const char *>(val) + first, size - first);
+
+                    this->at(offset).store(offset + occupied, boost::memory_order_release);
+                    boost::atomic_thread_fence(boost::memory_order_seq_cst);
+                    this->do_advance(offset);
+                    // 唤醒等待水位的写入者与刷盘线程, 没有等待者时不写 header
+                    mmap_.notify();
+
+                    mmap_.count(&detail::stats::pushes);
+                    mmap_.count(&detail::stats::bytes, size);
+                    return index_.push({offset, size});
+                }
+
+                /// 复制第 index 条数据到 val, 只有返回 ok 时 val 有效
+                status_t read(size_type index, std::vector<char> &val) const
+                {
+                    record rec;
+                    auto status = index_.read(index, rec);
+                    if (status != status_t::ok)
+                        return status;
+
+                    auto self = const_cast<variable_table *>(this);
+                    auto begin = rec.offset % capacity_;
+                    auto first = (std::min)(static_cast<size_type>(rec.size), capacity_ - begin);
+                    val.resize(rec.size);
+                    memcpy(val.data(), self->data() + begin, first);
+                    memcpy(val.data() + first, self->data(), rec.size - first);
+
+                    // 占用超过 offset + capacity 的写入者可能已经改写了这段数据
+                    boost::atomic_thread_fence(boost::memory_order_acquire);
+                    if (mmap_.size() > rec.offset + capacity_)
+                        return status_t::lapped;
+                    return status_t::ok;
+                }
+
+                bool has_value(size_type index) const
+                {
+                    return index_.has_value(index);
+                }
+
+                void wait(size_type index) const
+                {
+                    index_.wait(index);
+                }
+
+                size_type oldest() const
+                {
+                    return index_.oldest();
+                }
+
+                bool empty() const
+                {
+                    return index_.empty();
+                }
+
+                /// {已占用的序号数, 已占用的字节数}
+                std::pair<size_type, size_type> size() const
+                {
+                    return {index_.size(), mmap_.size()};
+                }
+
+                std::pair<size_type, size_type> capacity() const
+                {
+                    return {index_.capacity(), capacity_};
+                }
+
+                std::pair<const std::string &, const std::string &> name() const
+                {
+                    return {index_.name(), mmap_.name()};
+                }
+            };
+
+            /// 顺序读取环形 table 的读者, 被套圈时跳到 oldest 并累计丢失的条数
+            template <typename Table>
+            class reader
+            {
+            public:
+                using table_type = Table;
+                using size_type = std::size_t;
+
+            private:
+                const table_type &table_;
+                size_type position_;
+                size_type lost_ = 0;
+
+            public:
+                reader(const table_type &table, size_type position = 0)
+                    : table_(table), position_(position)
+                {
+                }
+
+                /// 不等待地读取下一条数据; 返回 lapped 时位置已重新定位, 可以直接再次调用
+                template <typename Value>
+                status_t next(Value &val)
+                {
+                    auto status = table_.read(position_, val);
+                    if (status == status_t::ok)
+                        ++position_;
+                    else if (status == status_t::lapped)
+                    {
+                        auto oldest = (std::max)(table_.oldest(), position_ + 1);
+                        lost_ += oldest - position_;
+                        position_ = oldest;
+                    }
+                    return status;
+                }
+
+                /// 等待并读取下一条数据, 期间被套圈时自动重新定位
+                template <typename Value>
+                void wait_next(Value &val)
+                {
+                    for (;;)
+                    {
+                        table_.wait(position_);
+                        if (this->next(val) == status_t::ok)
+                            return;
+                    }
+                }
+
+                size_type position() const
+                {
+                    return position_;
+                }
+
+                void seek(size_type position)
+                {
+                    position_ = position;
+                }
+
+                /// 因被套圈而跳过的数据条数
+                size_type lost() const
+                {
+                    return lost_;
+                }
+            };
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,408 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace air
+{
+    namespace lightmdb
+    {
+        /// 列扫描的比较方式, 数据 op 给定值
+        enum class compare_t : int8_t
+        {
+            less = 0,
+            less_equal,
+            equal,
+            not_equal,
+            greater,
+            greater_equal
+        };
+
+        namespace detail
+        {
+            /// 连续数组上的批量运算: GCC/Clang 用向量扩展生成 16 字节 (SSE2/NEON) 与 32 字节 (AVX2, 运行时检测) 的实现
+            /// 其他编译器与非算术类型使用标量实现; 浮点求和的累加顺序与标量实现不同, 结果可能有舍入误差
+            namespace simd
+            {
+                /// 求和结果类型: 整数扩展到 64 位, 浮点为 double
+                template <typename T>
+                using sum_t = std::conditional_t<std::is_floating_point_v<T>, double, std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>>;
+
+                /// 可以使用向量实现的元素类型
+                template <typename T>
+                constexpr bool vectorizable = std::is_arithmetic_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, long double>;
+
+                template <compare_t Op, typename T>
+                bool compare(const T &a, const T &b)
+                {
+                    if constexpr (Op == compare_t::less)
+                        return a < b;
+                    else if constexpr (Op == compare_t::less_equal)
+                        return a <= b;
+                    else if constexpr (Op == compare_t::equal)
+                        return a == b;
+                    else if constexpr (Op == compare_t::not_equal)
+                        return a != b;
+                    else if constexpr (Op == compare_t::greater)
+                        return b < a;
+                    else
+                        return b <= a;
+                }
+
+                /// 标量实现, 也用于向量实现处理不足一个向量的尾部
+                struct scalar
+                {
+                    template <typename T>
+                    static sum_t<T> sum(const T *data, std::size_t n)
+                    {
+                        sum_t<T> result = 0;
+                        for (std::size_t i = 0; i < n; ++i)
+                            result += data[i];
+                        return result;
+                    }
+
+                    /// 要求 n > 0
+                    template <typename T>
+                    static T min(const T *data, std::size_t n)
+                    {
+                        auto result = data[0];
+                        for (std::size_t i = 1; i < n; ++i)
+                            result = data[i] < result ? data[i] : result;
+                        return result;
+                    }
+
+                    template <typename T>
+                    static T max(const T *data, std::size_t n)
+                    {
+                        auto result = data[0];
+                        for (std::size_t i = 1; i < n; ++i)
+                            result = result < data[i] ? data[i] : result;
+                        return result;
+                    }
+
+                    template <compare_t Op, typename T>
+                    static std::size_t count(const T *data, std::size_t n, const T &value)
+                    {
+                        std::size_t result = 0;
+                        for (std::size_t i = 0; i < n; ++i)
+                            result += compare<Op>(data[i], value);
+                        return result;
+                    }
+
+                    /// 对满足条件的位置 i 调用 func(i)
+                    template <compare_t Op, typename T, typename Func>
+                    static void scan(const T *data, std::size_t n, const T &value, Func &&func)
+                    {
+                        for (std::size_t i = 0; i < n; ++i)
+                        {
+                            if (compare<Op>(data[i], value))
+                                func(i);
+                        }
+                    }
+                };
+
+#if defined(__GNUC__)
+                template <typename T, std::size_t Bytes>
+                struct vector_of
+                {
+                    typedef T type __attribute__((vector_size(Bytes)));
+                };
+
+                /// Bytes 字节的向量实现, 函数强制内联, 由调用者的目标指令集决定生成的指令
+                /// 向量只通过引用传递, 不作为参数或返回值, 避免不同指令集之间的 ABI 差异
+                template <std::size_t Bytes>
+                struct vectorized
+                {
+                    template <typename T>
+                    using vector = typename vector_of<T, Bytes>::type;
+
+                    template <typename T>
+                    static constexpr std::size_t lanes = Bytes / sizeof(T);
+
+                    template <typename T>
+                    [[gnu::always_inline]] static inline void load(const T *data, vector<T> &val)
+                    {
+                        memcpy(&val, data, sizeof(val));
+                    }
+
+                    template <compare_t Op, typename V, typename M>
+                    [[gnu::always_inline]] static inline void compare(const V &a, const V &b, M &mask)
+                    {
+                        if constexpr (Op == compare_t::less)
+                            mask = a < b;
+                        else if constexpr (Op == compare_t::less_equal)
+                            mask = a <= b;
+                        else if constexpr (Op == compare_t::equal)
+                            mask = a == b;
+                        else if constexpr (Op == compare_t::not_equal)
+                            mask = a != b;
+                        else if constexpr (Op == compare_t::greater)
+                            mask = a > b;
+                        else
+                            mask = a >= b;
+                    }
+
+                    template <typename T>
+                    [[gnu::always_inline]] static inline sum_t<T> sum(const T *data, std::size_t n)
+                    {
+                        using result_vector = typename vector_of<sum_t<T>, lanes<T> * sizeof(sum_t<T>)>::type;
+
+                        result_vector acc = {};
+                        std::size_t i = 0;
+                        for (; i + lanes<T> <= n; i += lanes<T>)
+                        {
+                            vector<T> val;
+                            load(data + i, val);
+                            acc += __builtin_convertvector(val, result_vector);
+                        }
+
+                        auto result = scalar::sum(data + i, n - i);
+                        for (std::size_t j = 0; j < lanes<T>; ++j)
+                            result += acc[j];
+                        return result;
+                    }
+
+                    template <typename T>
+                    [[gnu::always_inline]] static inline T min(const T *data, std::size_t n)
+                    {
+                        if (n < lanes<T>)
+                            return scalar::min(data, n);
+
+                        vector<T> acc;
+                        load(data, acc);
+                        std::size_t i = lanes<T>;
+                        for (; i + lanes<T> <= n; i += lanes<T>)
+                        {
+                            vector<T> val;
+                            load(data + i, val);
+                            acc = val < acc ? val : acc;
+                        }
+
+                        auto result = acc[0];
+                        for (std::size_t j = 1; j < lanes<T>; ++j)
+                            result = acc[j] < result ? acc[j] : result;
+                        return i < n ? (std::min)(result, scalar::min(data + i, n - i)) : result;
+                    }
+
+                    template <typename T>
+                    [[gnu::always_inline]] static inline T max(const T *data, std::size_t n)
+                    {
+                        if (n < lanes<T>)
+                            return scalar::max(data, n);
+
+                        vector<T> acc;
+                        load(data, acc);
+                        std::size_t i = lanes<T>;
+                        for (; i + lanes<T> <= n; i += lanes<T>)
+                        {
+                            vector<T> val;
+                            load(data + i, val);
+                            acc = acc < val ? val : acc;
+                        }
+
+                        auto result = acc[0];
+                        for (std::size_t j = 1; j < lanes<T>; ++j)
+                            result = result < acc[j] ? acc[j] : result;
+                        return i < n ? (std::max)(result, scalar::max(data + i, n - i)) : result;
+                    }
+
+                    template <compare_t Op, typename T>
+                    [[gnu::always_inline]] static inline std::size_t count(const T *data, std::size_t n, const T &value)
+                    {
+                        using mask_vector = decltype(std::declval<vector<T>>() < std::declval<vector<T>>());
+                        using lane_type = std::remove_cvref_t<decltype(std::declval<mask_vector>()[0])>;
+                        // 每个通道的计数不能溢出, 按块累加
+                        constexpr std::size_t block = (std::min)(std::size_t((std::numeric_limits<lane_type>::max)()), std::size_t(1) << 20);
+
+                        vector<T> target = vector<T>{} + value;
+                        std::size_t result = 0;
+                        std::size_t i = 0;
+                        while (i + lanes<T> <= n)
+                        {
+                            mask_vector acc = {};
+                            for (std::size_t k = 0; k < block && i + lanes<T> <= n; ++k, i += lanes<T>)
+                            {
+                                vector<T> val;
+                                mask_vector mask;
+                                load(data + i, val);
+                                compare<Op>(val, target, mask);
+                                acc -= mask;
+                            }
+                            for (std::size_t j = 0; j < lanes<T>; ++j)
+                                result += static_cast<std::size_t>(acc[j]);
+                        }
+                        return result + scalar::count<Op>(data + i, n - i, value);
+                    }
+
+                    template <compare_t Op, typename T, typename Func>
+                    [[gnu::always_inline]] static inline void scan(const T *data, std::size_t n, const T &value, Func &func)
+                    {
+                        using mask_vector = decltype(std::declval<vector<T>>() < std::declval<vector<T>>());
+
+                        vector<T> target = vector<T>{} + value;
+                        std::size_t i = 0;
+                        for (; i + lanes<T> <= n; i += lanes<T>)
+                        {
+                            vector<T> val;
+                            mask_vector mask;
+                            load(data + i, val);
+                            compare<Op>(val, target, mask);
+
+                            // 整个向量都不满足时跳过逐通道检查
+                            std::uint64_t words[Bytes / sizeof(std::uint64_t)];
+                            memcpy(words, &mask, sizeof(words));
+                            std::uint64_t any = 0;
+                            for (auto word : words)
+                                any |= word;
+                            if (any == 0)
+                                continue;
+
+                            for (std::size_t j = 0; j < lanes<T>; ++j)
+                            {
+                                if (mask[j])
+                                    func(i + j);
+                            }
+                        }
+                        scalar::scan<Op>(data + i, n - i, value, [&](std::size_t j)
+                                         { func(i + j); });
+                    }
+                };
+
+#if defined(__x86_64__) || defined(__i386__)
+                inline bool has_avx2()
+                {
+                    static const bool val = __builtin_cpu_supports("avx2");
+                    return val;
+                }
+
+                template <typename T>
+                __attribute__((target("avx2"))) sum_t<T> sum_avx2(const T *data, std::size_t n)
+                {
+                    return vectorized<32>::sum(data, n);
+                }
+
+                template <typename T>
+                __attribute__((target("avx2"))) T min_avx2(const T *data, std::size_t n)
+                {
+                    return vectorized<32>::min(data, n);
+                }
+
+                template <typename T>
+                __attribute__((target("avx2"))) T max_avx2(const T *data, std::size_t n)
+                {
+                    return vectorized<32>::max(data, n);
+                }
+
+                template <compare_t Op, typename T>
+                __attribute__((target("avx2"))) std::size_t count_avx2(const T *data, std::size_t n, const T &value)
+                {
+                    return vectorized<32>::count<Op>(data, n, value);
+                }
+
+                template <compare_t Op, typename T, typename Func>
+                __attribute__((target("avx2"))) void scan_avx2(const T *data, std::size_t n, const T &value, Func &func)
+                {
+                    vectorized<32>::scan<Op>(data, n, value, func);
+                }
+
+#define AIR_LIGHTMDB_SIMD_DISPATCH(avx2_call, call) \
+    if (has_avx2())                                 \
+        return avx2_call;                           \
+    return call;
+#else
+#define AIR_LIGHTMDB_SIMD_DISPATCH(avx2_call, call) return call;
+#endif
+#endif
+
+                /// 选择可用的最宽实现
+                template <typename T>
+                sum_t<T> sum(const T *data, std::size_t n)
+                {
+#if defined(__GNUC__)
+                    if constexpr (vectorizable<T>)
+                    {
+                        AIR_LIGHTMDB_SIMD_DISPATCH(sum_avx2(data, n), vectorized<16>::sum(data, n))
+                    }
+#endif
+                    return scalar::sum(data, n);
+                }
+
+                template <typename T>
+                T min(const T *data, std::size_t n)
+                {
+#if defined(__GNUC__)
+                    if constexpr (vectorizable<T>)
+                    {
+                        AIR_LIGHTMDB_SIMD_DISPATCH(min_avx2(data, n), vectorized<16>::min(data, n))
+                    }
+#endif
+                    return scalar::min(data, n);
+                }
+
+                template <typename T>
+                T max(const T *data, std::size_t n)
+                {
+#if defined(__GNUC__)
+                    if constexpr (vectorizable<T>)
+                    {
+                        AIR_LIGHTMDB_SIMD_DISPATCH(max_avx2(data, n), vectorized<16>::max(data, n))
+                    }
+#endif
+                    return scalar::max(data, n);
+                }
+
+                template <compare_t Op, typename T>
+                std::size_t count(const T *data, std::size_t n, const T &value)
+                {
+#if defined(__GNUC__)
+                    if constexpr (vectorizable<T>)
+                    {
+                        AIR_LIGHTMDB_SIMD_DISPATCH(count_avx2<Op>(data, n, value), vectorized<16>::count<Op>(data, n, value))
+                    }
+#endif
+                    return scalar::count<Op>(data, n, value);
+                }
+
+                template <compare_t Op, typename T, typename Func>
+                void scan(const T *data, std::size_t n, const T &value, Func &func)
+                {
+#if defined(__GNUC__)
+                    if constexpr (vectorizable<T>)
+                    {
+                        AIR_LIGHTMDB_SIMD_DISPATCH(scan_avx2<Op>(data, n, value, func), vectorized<16>::scan<Op>(data, n, value, func))
+                    }
+#endif
+                    scalar::scan<Op>(data, n, value, func);
+                }
+
+#if defined(__GNUC__)
+#undef AIR_LIGHTMDB_SIMD_DISPATCH
+#endif
+
+                /// 把运行时的比较方式分派到编译期实现
+                template <typename Func>
+                decltype(auto) dispatch(compare_t op, Func &&func)
+                {
+                    switch (op)
+                    {
+                    case compare_t::less:
+                        return func(std::integral_constant<compare_t, compare_t::less>{});
+                    case compare_t::less_equal:
+                        return func(std::integral_constant<compare_t, compare_t::less_equal>{});
+                    case compare_t::equal:
+                        return func(std::integral_constant<compare_t, compare_t::equal>{});
+                    case compare_t::not_equal:
+                        return func(std::integral_constant<compare_t, compare_t::not_equal>{});
+                    case compare_t::greater:
+                        return func(std::integral_constant<compare_t, compare_t::greater>{});
+                    default:
+                        return func(std::integral_constant<compare_t, compare_t::greater_equal>{});
+                    }
+                }
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+
+#include "air/lightmdb/core.hpp"
+
+namespace air
+{
+    namespace lightmdb
+    {
+        /// 按键定位: 数据的键 (例如时间戳) 随下标单调不减时, 每 Interval 条数据记录一次 (键, 下标)
+        namespace sparse
+        {
+            /// fixed::table 与 variable::table 的稀疏键索引, 保存在 name + "k" 文件中
+            /// extract(table[index]) 返回数据的键, 键必须随下标单调不减, 可以用 < 比较且可平凡复制
+            /// 索引由可写映射在 update 时向后扩展到连续已发布的数据 (committed), 只读映射只使用已有的条目
+            /// 写入者通过 push 写入时每 Interval 条数据更新一次, 只读映射的索引随之扩展; 直接写入 table 时需要自己调用 update
+            /// 构建锁是 header.lock, 构建中崩溃会留下锁, 之后的 update 直接返回 (查找退化为在最后一项之后二分), 由 options::recover 清除
+            template <typename Table, typename Extract, std::size_t Interval = 1024>
+            class key_index
+            {
+            public:
+                using table_type = Table;
+                using size_type = std::size_t;
+                using key_type = std::decay_t<std::invoke_result_t<Extract &, decltype(std::declval<Table &>()[size_type(0)])>>;
+
+                static_assert(Interval != 0, "interval must not be 0");
+                static_assert(std::is_trivially_copyable_v<key_type>, "key index requires trivially copyable key");
+
+            private:
+                /// 第 k 项为下标不小于 k * Interval 的第一条非跳过数据的键与下标
+                struct entry
+                {
+                    key_type key;
+                    std::uint64_t index;
+                };
+
+                table_type &table_;
+                Extract extract_;
+                // header.lock 作为构建锁, header.size 为已发布的条目字节数
+                detail::mmap index_;
+
+                static std::string file_name(const std::string &name)
+                {
+                    return name + "k";
+                }
+
+                /// 键索引只沿用存储后端与崩溃恢复
+                static options index_options(const options &opts)
+                {
+                    options index;
+                    index.backend = opts.backend;
+                    index.recover = opts.recover;
+                    return index;
+                }
+
+                /// options::recover 时清除崩溃留下的构建锁, 调用时不能有其他进程在构建
+                void recover(const options &opts)
+                {
+                    if (opts.recover && index_.writable())
+                        index_.get_header().lock = false;
+                }
+
+                size_type entries() const
+                {
+                    return index_.size() / sizeof(entry);
+                }
+
+                entry &at(size_type k)
+                {
+                    if ((k + 1) * sizeof(entry) > index_.capacity())
+                        index_.remmap();
+                    return *index_.template at<entry>(k);
+                }
+
+                key_type key_of(size_type index)
+                {
+                    return extract_(table_[index]);
+                }
+
+                /// 写入第 k 项并发布, 调用者持有构建锁
+                void do_append(size_type k, const entry &val)
+                {
+                    while ((k + 1) * sizeof(entry) > index_.get_header().capacity)
+                        index_.recapacity();
+
+                    this->at(k) = val;
+                    index_.get_header().size.store((k + 1) * sizeof(entry), boost::memory_order_release);
+                }
+
+                /// [first, last) 中第一条键不小于 key 的非跳过数据, 没有时返回 last; 跳过标记向后找到下一条数据再比较
+                size_type search(size_type first, size_type last, const key_type &key)
+                {
+                    while (first < last)
+                    {
+                        auto mid = first + (last - first) / 2;
+                        auto probe = mid;
+                        while (probe < last && table_.skipped(probe))
+                            ++probe;
+
+                        if (probe < last && this->key_of(probe) < key)
+                            first = probe + 1;
+                        else
+                            last = mid;
+                    }
+
+                    while (first < table_.committed() && table_.skipped(first))
+                        ++first;
+                    return first;
+                }
+
+            public:
+                /// 创建索引, capacity 为初始条目数
+                key_index(table_type &table, const std::string &name, mode_t mode, size_type capacity, Extract extract = {}, const options &opts = {})
+                    : table_(table), extract_(std::move(extract)), index_(file_name(name), mode, (std::max)(capacity, size_type(1)) * sizeof(entry), index_options(opts), sizeof(entry))
+                {
+                    this->recover(opts);
+                }
+
+                key_index(table_type &table, const std::string &name, mode_t mode, Extract extract = {}, const options &opts = {})
+                    : table_(table), extract_(std::move(extract)), index_(file_name(name), mode, index_options(opts))
+                {
+                    this->recover(opts);
+                }
+
+                /// 把索引推进到连续已发布的数据末尾, 返回条目数; 只读映射或其他进程正在构建时直接返回
+                /// 每项只读取一条数据; 第一次对已有的大表调用时读取约 committed / Interval 条, 期间持有构建锁
+                size_type update()
+                {
+                    if (!index_.writable() || index_.get_header().lock.exchange(true))
+                        return this->entries();
+
+                    // 第一条非跳过数据一旦发布, 该项就不再变化, 最后一段不必写满
+                    auto count = this->entries();
+                    try
+                    {
+                        auto committed = table_.committed();
+                        for (; count * Interval < committed; ++count)
+                        {
+                            auto index = count * Interval;
+                            while (index < committed && table_.skipped(index))
+                                ++index;
+                            if (index == committed)
+                                break;
+
+                            this->do_append(count, {this->key_of(index), index});
+                        }
+                    }
+                    catch (...)
+                    {
+                        index_.get_header().lock = false;
+                        throw;
+                    }
+
+                    index_.get_header().lock = false;
+                    return count;
+                }
+
+                /// 写入 table 并在写满一段时更新索引, 返回数据下标; 参数原样转发给 table.push
+                /// 多写入者时由跨过段边界的写入者更新, 其他进程正在构建或之前的数据尚未发布时留给之后的段边界
+                template <typename... Args>
+                size_type push(Args &&...args)
+                {
+                    auto index = static_cast<size_type>(table_.push(std::forward<Args>(args)...));
+                    if ((index + 1) % Interval == 0)
+                        this->update();
+                    return index;
+                }
+
+                /// 第一条键不小于 key 的数据下标, 只在连续已发布的数据中查找, 没有时返回 committed()
+                /// 先在索引中二分找到所在的段, 再在段内二分; 索引已更新到 committed 时读取的数据条数为 O(log Interval)
+                size_type lower_bound(const key_type &key)
+                {
+                    auto count = this->update();
+                    auto committed = table_.committed();
+
+                    // 第一项键不小于 key 的段之前一段必然包含答案的起点
+                    size_type first = 0, last = count;
+                    while (first < last)
+                    {
+                        auto mid = first + (last - first) / 2;
+                        if (this->at(mid).key < key)
+                            first = mid + 1;
+                        else
+                            last = mid;
+                    }
+
+                    auto begin = first == 0 ? 0 : static_cast<size_type>(this->at(first - 1).index);
+                    auto end = first < count ? static_cast<size_type>(this->at(first).index) + 1 : committed;
+                    return this->search(begin, (std::min)(end, committed), key);
+                }
+
+                /// 已建立的索引条目数
+                size_type size() const
+                {
+                    return this->entries();
+                }
+
+                const std::string &name() const
+                {
+                    return index_.name();
+                }
+            };
+        }
+    }
+}
\ No newline at end of file
@@ -1,12 +1,22 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <string_view>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
 #include <utility>
 
 #include "air/lightmdb/core.hpp"
+#include "air/lightmdb/async.hpp"
 #include "air/lightmdb/fixed.hpp"
+#include "air/lightmdb/archive.hpp"
 
 namespace air
 {
@@ -14,62 +24,182 @@ namespace air
     {
         namespace variable
         {
-            template <bool IsLock = true>
+            /// Producer 为 producer_t::single 时数据区与索引都只允许一个写入者
+            template <bool IsLock = true, producer_t Producer = producer_t::multi>
             class table
             {
             public:
                 using size_type = std::size_t;
                 using difference_type = std::ptrdiff_t;
+                using index_type = fixed::table<std::pair<size_type, size_type>, IsLock, layout::packed, Producer>;
 
             private:
-                fixed::table<std::pair<size_type, size_type>, IsLock> offset_db_;
+                static constexpr bool single = Producer == producer_t::single;
+                /// 单写入者在数据写完后才发布 header.size; 多写入者先占用再写入, 由登记的 epoch 推进数据区水位
+                static constexpr detail::published_t published = single ? detail::published_t::size : detail::published_t::epoch;
+
+                index_type offset_db_;
                 detail::mmap mmap_;
-                char *data_;
 
                 // 本地 capacity
                 size_type capacity_;
 
+                // 单写入者的本地数据区写入位置, 随索引一起 flush 到 header.size
+                size_type write_;
+
+                // 压缩归档, 第一次 archive 或读取已释放的数据时打开
+                std::unique_ptr<detail::block_archive> archive_;
+                // 上次没有找到归档文件时索引区与数据区的已释放量之和; 归档总在释放之前追加, 释放推进之前不再检查文件
+                size_type archive_miss_ = std::numeric_limits<size_type>::max();
+                backend_t backend_;
+
+                size_type do_fetch(size_type size)
+                {
+                    if constexpr (single)
+                    {
+                        auto index = write_;
+                        write_ += size;
+                        return index;
+                    }
+
+                    return mmap_.get_header().size.fetch_add(size);
+                }
+
+                /// 索引刚好发布到 header.size 时, 同步发布数据区的写入位置
+                size_type do_commit(size_type offset, size_type size)
+                {
+                    auto index = offset_db_.push({offset, size});
+                    if constexpr (single)
+                    {
+                        if ((index + 1) % detail::flush_interval == 0)
+                            this->do_flush();
+                    }
+                    return index;
+                }
+
+                /// 发布单写入者的数据区写入位置, 并唤醒等待水位的刷盘线程
+                void do_flush()
+                {
+                    mmap_.get_header().size.store(write_, boost::memory_order_release);
+                    boost::atomic_thread_fence(boost::memory_order_seq_cst);
+                    mmap_.notify();
+                }
+
+                /// 多写入者先占用数据区再写入, 在占用之前登记, 建立索引之后离开, 数据区水位见 detail::mmap::publish
+                /// func 占用, 写入并发布一条数据, 返回其下标
+                template <typename Func>
+                size_type do_write(Func &&func)
+                {
+                    if constexpr (single)
+                        return func();
+                    else
+                    {
+                        auto slot = mmap_.enter();
+                        try
+                        {
+                            auto index = func();
+                            mmap_.leave(slot);
+                            return index;
+                        }
+                        catch (...)
+                        {
+                            mmap_.leave(slot);
+                            throw;
+                        }
+                    }
+                }
+
                 void remmap()
                 {
                     capacity_ = mmap_.get_header().capacity;
                     mmap_.remmap();
-                    data_ = static_cast<char *>(mmap_.get_address());
+                }
+
+                /// 占用 size 字节, 分段存储时跨段的区间直接作废重新占用
+                size_type do_claim(size_type size)
+                {
+                    if (size > mmap_.segment_size())
+                        throw std::runtime_error("data larger than segment");
+
+                    auto index = this->do_fetch(size);
+                    while (!mmap_.contiguous(index, size))
+                        index = this->do_fetch(size);
+
+                    return index;
+                }
+
+                /// 保证 [index, index + size) 已映射, 返回写入地址
+                void *do_reserve(size_type size, size_type index)
+                {
+                    mmap_.reserve_until(
+                        index + size, IsLock && !single, [this]()
+                        { return capacity_; },
+                        [this]()
+                        { this->remmap(); });
+
+                    return mmap_.template at<char>(index);
                 }
 
                 /// 推入数据
                 size_type do_push(const void *val, size_type size, size_type index)
                 {
-                    while (index + size > capacity_)
+                    memcpy(this->do_reserve(size, index), val, size);
+                    mmap_.count(&detail::stats::pushes);
+                    mmap_.count(&detail::stats::bytes, size);
+                    return index;
+                }
+
+                /// 把 parts 依次复制到 [index, index + size) 拼接为一条数据
+                size_type do_push(std::span<const std::pair<const void *, size_type>> parts, size_type size, size_type index)
+                {
+                    auto dest = static_cast<char *>(this->do_reserve(size, index));
+                    for (auto &part : parts)
                     {
-                        auto &header = mmap_.get_header();
+                        if (part.second != 0)
+                            memcpy(dest, part.first, part.second);
+                        dest += part.second;
+                    }
+                    mmap_.count(&detail::stats::pushes);
+                    mmap_.count(&detail::stats::bytes, size);
+                    return index;
+                }
 
-                        if constexpr (IsLock == true)
-                        {
-                            auto flag = header.lock.exchange(true);
+                /// options::segment 为数据区每段的字节数, 索引每段的条数按每条数据 16 字节 (一条索引的大小) 换算, 至少 2 条
+                static options index_options(const options &opts)
+                {
+                    auto index = opts;
+                    if (opts.segment != 0)
+                        index.segment = (std::max)(opts.segment / sizeof(std::pair<size_type, size_type>), size_type(2));
+                    return index;
+                }
 
-                            if (!flag)
-                            {
-                                if (capacity_ == this->capacity().second)
-                                {
-                                    mmap_.recapacity();
-                                }
+                /// 打开已有的归档, 不存在时返回 nullptr; 没有找到时缓存结果, 读取已释放数据的读者不必每条都检查文件
+                detail::block_archive *do_archive()
+                {
+                    if (archive_)
+                        return archive_.get();
 
-                                header.lock = false;
-                                header.capacity.notify_all();
-                            }
+                    auto discarded = offset_db_.discarded() + mmap_.discarded();
+                    if (discarded == archive_miss_)
+                        return nullptr;
 
-                            header.capacity.wait(capacity_);
-                        }
-                        else
-                        {
-                            mmap_.recapacity();
-                            header.capacity.wait(capacity_);
-                        }
-                        this->remmap();
+                    if (!detail::backend_exists(detail::block_archive::file_name(mmap_.name()), backend_))
+                    {
+                        archive_miss_ = discarded;
+                        return nullptr;
                     }
 
-                    memcpy(&data_[index], val, size);
-                    return index;
+                    options opts;
+                    opts.backend = backend_;
+                    archive_ = std::make_unique<detail::block_archive>(mmap_.name(), mmap_.writable() ? mode_t::read_write : mode_t::read_only, opts);
+                    return archive_.get();
+                }
+
+                /// 索引或数据已被释放时从归档读取, 没有归档该条数据时返回 nullptr
+                detail::block_archive *do_archived(size_type index)
+                {
+                    auto archive = this->do_archive();
+                    return archive != nullptr && index < archive->archived() ? archive : nullptr;
                 }
 
                 void *do_read(size_type index, size_type size)
@@ -77,34 +207,178 @@ namespace air
                     while (index + size > capacity_)
                     {
                         auto &header = mmap_.get_header();
+                        if (header.capacity == capacity_)
+                            mmap_.count(&detail::stats::capacity_waits);
                         header.capacity.wait(capacity_);
 
                         this->remmap();
                     }
-                    return &data_[index];
+                    return mmap_.template at<char>(index);
                 }
 
             public:
-                table(const std::string &name, mode_t mode, size_type capacity, size_type index_capacity)
-                    : offset_db_(name + "i", mode, index_capacity), mmap_(name, mode, capacity)
+                /// 写入者独占的块写入器, 索引按 count 条, 数据区按 bytes 字节成块占用, 见 fixed::table::chunk
+                /// 数据区块尾放不下下一条数据时剩余字节作废, 大于 bytes 的数据单独占用
+                class chunk
+                {
+                    table &table_;
+                    typename index_type::chunk index_;
+                    size_type bytes_;
+                    size_type next_ = 0;
+                    size_type end_ = 0;
+                    // 多写入者持有数据区块期间保持登记, 块内之后写入的数据同样不能越过水位
+                    bool entered_ = false;
+                    std::uint32_t slot_ = 0;
+
+                    void leave()
+                    {
+                        if (entered_)
+                        {
+                            table_.mmap_.leave(slot_);
+                            entered_ = false;
+                        }
+                    }
+
+                public:
+                    chunk(table &table, size_type count, size_type bytes)
+                        : table_(table), index_(table.offset_db_, count), bytes_(bytes)
+                    {
+                        if (bytes > table.mmap_.segment_size())
+                            throw std::runtime_error("chunk larger than segment");
+                    }
+
+                    chunk(const chunk &) = delete;
+                    chunk &operator=(const chunk &) = delete;
+
+                    ~chunk()
+                    {
+                        this->leave();
+                    }
+
+                    size_type push(const void *val, size_type size)
+                    {
+                        if (size > bytes_)
+                        {
+                            return table_.do_write([&]()
+                                                   { return index_.push({table_.do_push(val, size, table_.do_claim(size)), size}); });
+                        }
+
+                        if (end_ - next_ < size)
+                        {
+                            // 先离开再为新块登记, 旧块剩余的字节作废
+                            this->leave();
+                            if constexpr (!single)
+                            {
+                                slot_ = table_.mmap_.enter();
+                                entered_ = true;
+                            }
+                            next_ = table_.do_claim(bytes_);
+                            end_ = next_ + bytes_;
+                        }
+                        auto index = next_;
+                        next_ += size;
+                        return index_.push({table_.do_push(val, size, index), size});
+                    }
+
+                    /// 把索引块剩余的位置发布为跳过标记, 作废数据区块剩余的字节
+                    void flush()
+                    {
+                        index_.flush();
+                        next_ = end_;
+                        this->leave();
+                    }
+                };
+
+                /// reserve 返回的写入句柄
+                struct reservation
+                {
+                    void *data;
+                    size_type offset;
+                    size_type size;
+                    /// 多写入者在 reserve 时登记的槽位, commit 时离开
+                    std::uint32_t slot;
+                };
+
+                table(const std::string &name, mode_t mode, size_type capacity, size_type index_capacity, const options &opts = {})
+                    : offset_db_(name + "i", mode, index_capacity, index_options(opts)), mmap_(name, mode, capacity, detail::check_growth(opts, IsLock && !single), 1, published), backend_(opts.backend)
                 {
-                    data_ = static_cast<char *>(mmap_.get_address());
                     capacity_ = this->capacity().second;
+                    write_ = mmap_.size();
+                    if (opts.recover && mmap_.writable())
+                        this->recover();
                 }
 
-                table(const std::string &name, mode_t mode)
-                    : offset_db_(name + "i", mode), mmap_(name, mode)
+                table(const std::string &name, mode_t mode, const options &opts = {})
+                    : offset_db_(name + "i", mode, index_options(opts)), mmap_(name, mode, detail::check_growth(opts, IsLock && !single), published), backend_(opts.backend)
                 {
-                    data_ = static_cast<char *>(mmap_.get_address());
                     capacity_ = this->capacity().second;
+                    write_ = mmap_.size();
+                    if (opts.recover && mmap_.writable())
+                        this->recover();
                 }
 
-                ~table() = default;
+                ~table()
+                {
+                    if constexpr (single)
+                    {
+                        if (write_ > mmap_.size())
+                            this->flush();
+                    }
+                }
 
                 size_type push(const void *val, size_type size)
                 {
-                    auto index = mmap_.get_header().size.fetch_add(size);
-                    return offset_db_.push({this->do_push(val, size, index), size});
+                    return this->do_write([&]()
+                                          { return this->do_commit(this->do_push(val, size, this->do_claim(size)), size); });
+                }
+
+                /// 分散写入: 把 parts ({地址, 字节数}) 依次拼接为一条数据, 只占用一次数据区, 各片段直接复制到映射区
+                /// 例如 push({{&header, sizeof(header)}, {payload, size}}), 不需要先拼接到临时缓冲区
+                size_type push(std::span<const std::pair<const void *, size_type>> parts)
+                {
+                    size_type size = 0;
+                    for (auto &part : parts)
+                        size += part.second;
+
+                    return this->do_write([&]()
+                                          { return this->do_commit(this->do_push(parts, size, this->do_claim(size)), size); });
+                }
+
+                size_type push(std::initializer_list<std::pair<const void *, size_type>> parts)
+                {
+                    return this->push(std::span<const std::pair<const void *, size_type>>(parts.begin(), parts.size()));
+                }
+
+                /// 在映射区内预留 size 字节, 调用者直接写入 data 后再 commit
+                /// data 只在本对象下一次 reserve/push 之前有效 (可能触发 remmap); 多写入者未 commit 的预留会阻止数据区水位推进
+                reservation reserve(size_type size)
+                {
+                    std::uint32_t slot = 0;
+                    if constexpr (!single)
+                        slot = mmap_.enter();
+
+                    try
+                    {
+                        auto index = this->do_claim(size);
+                        return {this->do_reserve(size, index), index, size, slot};
+                    }
+                    catch (...)
+                    {
+                        if constexpr (!single)
+                            mmap_.leave(slot);
+                        throw;
+                    }
+                }
+
+                /// 发布 reserve 得到的数据, 返回数据下标
+                size_type commit(const reservation &val)
+                {
+                    mmap_.count(&detail::stats::pushes);
+                    mmap_.count(&detail::stats::bytes, val.size);
+                    auto index = this->do_commit(val.offset, val.size);
+                    if constexpr (!single)
+                        mmap_.leave(val.slot);
+                    return index;
                 }
 
                 bool has_value(size_type index)
@@ -112,9 +386,39 @@ namespace air
                     return offset_db_.has_value(index);
                 }
 
+                /// index 处是否为 chunk 留下的跳过标记, 只在 has_value 返回 true 之后有意义
+                bool skipped(size_type index) const
+                {
+                    auto self = const_cast<table *>(this);
+                    if (index < offset_db_.discarded())
+                    {
+                        if (auto archive = self->do_archived(index))
+                            return archive->skipped(index);
+                    }
+                    return offset_db_.skipped(index);
+                }
+
+                /// 已归档且热区已释放的数据从归档解压读取, 指针指向本地缓存, 见 archive
                 std::pair<void *, size_type> operator[](size_type index)
                 {
+                    if (index < offset_db_.discarded())
+                    {
+                        if (auto archive = this->do_archived(index))
+                        {
+                            auto val = archive->get(index);
+                            return {const_cast<void *>(val.first), val.second};
+                        }
+                    }
+
                     auto offset = offset_db_[index];
+                    if (offset.first < mmap_.discarded())
+                    {
+                        if (auto archive = this->do_archived(index))
+                        {
+                            auto val = archive->get(index);
+                            return {const_cast<void *>(val.first), val.second};
+                        }
+                    }
                     return {do_read(offset.first, offset.second), offset.second};
                 }
 
@@ -138,6 +442,19 @@ namespace air
                     offset_db_.wait(index);
                 }
 
+                /// 协程等待 ready() 返回 true, 由索引 table 的发布唤醒, 见 fixed::table::async_until
+                template <typename Ready, typename Resume>
+                auto async_until(async::reactor &reactor, Ready ready, Resume resume) const
+                {
+                    return offset_db_.async_until(reactor, std::move(ready), std::move(resume));
+                }
+
+                /// co_await table.async_wait(reactor, index) 等待 index 处的数据发布, 不阻塞线程
+                auto async_wait(async::reactor &reactor, size_type index) const
+                {
+                    return offset_db_.async_wait(reactor, index);
+                }
+
                 bool empty() const
                 {
                     return this->offset_db_.empty();
@@ -145,9 +462,63 @@ namespace air
 
                 std::pair<size_type, size_type> size() const
                 {
+                    if constexpr (single)
+                        return {offset_db_.size(), (std::max)(mmap_.size(), write_)};
+
                     return {offset_db_.size(), mmap_.size()};
                 }
 
+                /// 单写入者模式下把本地写入位置发布到 header.size, 多写入者模式下无操作
+                void flush()
+                {
+                    if constexpr (single)
+                    {
+                        this->do_flush();
+                        offset_db_.flush();
+                    }
+                }
+
+                /// 连续已发布的数据条数, 由索引维护
+                size_type committed() const
+                {
+                    return offset_db_.committed();
+                }
+
+                /// 崩溃恢复, 把索引中的空洞发布为跳过标记, 见 fixed::table::recover; 多写入者同时清除崩溃的写入者在数据区的登记
+                /// 单写入者的索引越过崩溃前已发布但未 flush 的数据, 数据区写入位置随之移到最后一条数据之后
+                size_type recover()
+                {
+                    if constexpr (!single)
+                        mmap_.reset_writers();
+
+                    auto holes = offset_db_.recover();
+                    if constexpr (single)
+                    {
+                        auto count = offset_db_.size();
+                        if (count != 0 && !offset_db_.skipped(count - 1))
+                        {
+                            auto back = offset_db_[count - 1];
+                            write_ = (std::max)(write_, back.first + back.second);
+                        }
+                        this->do_flush();
+                    }
+                    return holes;
+                }
+
+                /// 先刷数据文件再刷索引, 保证已落盘的索引指向已落盘的数据
+                void sync()
+                {
+                    this->flush();
+                    mmap_.sync();
+                    offset_db_.sync();
+                }
+
+                /// 已刷盘的 {数据条数, 数据字节数}
+                std::pair<size_type, size_type> durable_size() const
+                {
+                    return {offset_db_.durable_size(), mmap_.durable_size()};
+                }
+
                 std::pair<size_type, size_type> max_size() const
                 {
                     return {offset_db_.max_size(), mmap_.max_size()};
@@ -160,16 +531,100 @@ namespace air
 
                 void shrink_to_fit()
                 {
+                    this->flush();
                     offset_db_.shrink_to_fit();
                     mmap_.shrink_to_fit();
                 }
 
-                fixed::table<std::pair<size_type, size_type>, IsLock> &index_table()
+                /// 对下标 [first, last) 的数据及其索引调用 madvise, 要求这些数据均已写入
+                void advise(size_type first, size_type last, advice_t advice)
+                {
+                    if (first >= last)
+                        return;
+
+                    auto begin = offset_db_[first].first;
+                    auto &back = offset_db_[last - 1];
+                    mmap_.advise(begin, back.first + back.second - begin, advice);
+                    offset_db_.advise(first, last, advice);
+                }
+
+                /// 释放下标 index 之前的数据及其索引占用的磁盘空间与内存, 下标不变, 见 fixed::table::discard_before
+                /// 要求 index 之前的数据均已发布; 多写入者时数据区中的位置与下标顺序不一定一致, 写入者也可能已占用数据但尚未建立索引,
+                /// 数据区只释放到数据区水位 (见 detail::mmap::publish) 与 [index, size) 中已发布条目的最小偏移, 耗时与未释放的条数成正比
+                bool discard_before(size_type index)
+                {
+                    this->flush();
+                    index = (std::min)(index, offset_db_.committed());
+                    if (index == 0)
+                        return true;
+
+                    size_type offset;
+                    if constexpr (single)
+                    {
+                        auto end = offset_db_.committed();
+                        offset = index < end ? offset_db_[index].first : mmap_.size();
+                    }
+                    else
+                    {
+                        // 先读取水位再读取索引的占用位置: 水位之前的数据都已建立索引, 之后才占用的索引条目指向的数据都不小于水位
+                        offset = mmap_.publish();
+                        auto end = offset_db_.size();
+                        for (auto i = index; i < end; ++i)
+                        {
+                            if (offset_db_.has_value(i) && !offset_db_.skipped(i))
+                                offset = (std::min)(offset, offset_db_[i].first);
+                        }
+                    }
+
+                    auto punched = mmap_.discard(offset);
+                    return offset_db_.discard_before(index) && punched;
+                }
+
+                /// 已释放的数据条数, 之前的下标不能再读取
+                size_type discarded() const
+                {
+                    return offset_db_.discarded();
+                }
+
+                /// 把下标 [archived(), index) 的已发布数据按块压缩追加到归档 (name + "z", 块索引 name + "zi"), 再用 discard_before 释放热区
+                /// 每块约 block_size 字节原始数据, 之后 operator[] 对这些下标只解压所在的块; 返回 discard_before 的结果
+                /// 与 discard_before 相同, 调用者保证归档期间没有读者持有这些数据在热区中的指针
+                bool archive(size_type index, size_type block_size = 256 << 10)
+                {
+                    if (!mmap_.writable())
+                        throw std::runtime_error("archive requires a writable mapping " + mmap_.name());
+
+                    this->flush();
+                    if (!this->do_archive())
+                    {
+                        options opts;
+                        opts.backend = backend_;
+                        archive_ = std::make_unique<detail::block_archive>(mmap_.name(), mode_t::open_or_create, block_size, opts);
+                    }
+
+                    auto last = archive_->append((std::min)(index, this->committed()), block_size, [this](size_type i)
+                                                 {
+                        if (offset_db_.skipped(i))
+                            return detail::block_archive::record{nullptr, 0, true};
+
+                        auto offset = offset_db_[i];
+                        return detail::block_archive::record{do_read(offset.first, offset.second), offset.second, false}; });
+                    return this->discard_before(last);
+                }
+
+                /// 已归档的数据条数, 之前的下标从归档读取
+                size_type archived() const
+                {
+                    auto archive = const_cast<table *>(this)->do_archive();
+                    return archive != nullptr ? archive->archived() : 0;
+                }
+
+                index_type &index_table()
                 {
                     return offset_db_;
                 }
 
-                const fixed::table<std::pair<size_type, size_type>, IsLock> &index_table() const
+                const index_type &index_table() const
                 {
                     return offset_db_;
                 }
@@ -0,0 +1,198 @@
+#include <cstddef>
+#include <cstdint>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <gtest/gtest.h>
+#include "air/lightmdb/fixed.hpp"
+#include "air/lightmdb/variable.hpp"
+#include "air/lightmdb/framed.hpp"
+#include "air/lightmdb/cursor.hpp"
+
+using namespace air::lightmdb;
+constexpr auto FILE_NAME = "async.db";
+
+/// 立即开始执行, 结束后自动销毁的协程
+struct task
+{
+    struct promise_type
+    {
+        task get_return_object()
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void()
+        {
+        }
+
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+    };
+};
+
+template <typename Table>
+task consume(async::reactor &reactor, Table &table, size_t count, size_t &sum)
+{
+    cursor<Table> reader(table);
+    for (size_t i = 0; i < count; i++)
+        sum += co_await reader.async_next(reactor);
+}
+
+TEST(async, many_tables)
+{
+    // 超过 futex_waitv 一次能等待的 128 个, 覆盖轮询剩余 table 的路径
+    constexpr size_t TABLES = 160;
+    constexpr size_t RECORDS = 100;
+    using table_type = fixed::table<size_t, true, layout::sequence>;
+
+    std::vector<std::unique_ptr<table_type>> tables;
+    for (size_t t = 0; t < TABLES; t++)
+        tables.push_back(std::make_unique<table_type>(FILE_NAME + std::to_string(t), air::lightmdb::mode_t::create_only, 8));
+
+    async::reactor reactor;
+    std::vector<size_t> sums(TABLES, 0);
+    for (size_t t = 0; t < TABLES; t++)
+        consume(reactor, *tables[t], RECORDS, sums[t]);
+    ASSERT_EQ(reactor.pending(), TABLES);
+
+    std::thread writer([&]()
+                       {
+        std::vector<std::unique_ptr<table_type>> writers;
+        for (size_t t = 0; t < TABLES; t++)
+            writers.push_back(std::make_unique<table_type>(FILE_NAME + std::to_string(t), air::lightmdb::mode_t::read_write));
+        for (size_t i = 0; i < RECORDS; i++)
+        {
+            for (size_t t = 0; t < TABLES; t++)
+                writers[t]->push(t + i);
+        } });
+
+    // 一个线程服务所有 table
+    reactor.run();
+    writer.join();
+
+    ASSERT_EQ(reactor.pending(), 0);
+    for (size_t t = 0; t < TABLES; t++)
+        ASSERT_EQ(sums[t], t * RECORDS + RECORDS * (RECORDS - 1) / 2);
+
+    tables.clear();
+    for (size_t t = 0; t < TABLES; t++)
+        air::lightmdb::remove(FILE_NAME + std::to_string(t));
+}
+
+task wait_all(async::reactor &reactor, variable::table<> &variable, framed::table<> &framed, size_t &done)
+{
+    co_await variable.async_wait(reactor, 9);
+    ++done;
+    co_await framed.async_wait(reactor, 0);
+    ++done;
+}
+
+TEST(async, variable_framed)
+{
+    variable::table<> variable(FILE_NAME, air::lightmdb::mode_t::create_only, 64, 8);
+    framed::table<> framed("async.framed", air::lightmdb::mode_t::create_only, 64);
+
+    async::reactor reactor;
+    size_t done = 0;
+    wait_all(reactor, variable, framed, done);
+    ASSERT_EQ(done, 0);
+
+    for (std::uint64_t i = 0; i < 9; i++)
+        variable.push(&i, sizeof(i));
+    ASSERT_EQ(reactor.run_once(std::chrono::milliseconds(1)), 0);
+    ASSERT_EQ(done, 0);
+
+    std::uint64_t val = 9;
+    variable.push(&val, sizeof(val));
+    framed.push(&val, sizeof(val));
+    reactor.run();
+    ASSERT_EQ(done, 2);
+
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "i");
+    air::lightmdb::remove("async.framed");
+    air::lightmdb::remove("async.framedx");
+}
+
+TEST(async, read_only)
+{
+    constexpr size_t RECORDS = 100;
+    using table_type = fixed::table<size_t>;
+    table_type writer(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+
+    // 只读映射通过可写的 header 视图登记 watchers, 写入者发布后由 futex 唤醒 reactor
+    table_type table(FILE_NAME, air::lightmdb::mode_t::read_only);
+    detail::mmap view(FILE_NAME, air::lightmdb::mode_t::read_only);
+    async::reactor reactor;
+    size_t sum = 0;
+    consume(reactor, table, RECORDS, sum);
+    ASSERT_EQ(view.get_header().watchers, 1);
+
+    std::thread thread([&]()
+                       {
+        for (size_t i = 0; i < RECORDS; i++)
+            writer.push(i); });
+    reactor.run();
+    thread.join();
+    ASSERT_EQ(sum, RECORDS * (RECORDS - 1) / 2);
+    ASSERT_EQ(view.get_header().watchers, 0);
+
+    air::lightmdb::remove(FILE_NAME);
+}
+
+#if defined(__linux__)
+TEST(async, cross_process)
+{
+    constexpr size_t RECORDS = 1000;
+    using table_type = fixed::table<size_t>;
+    table_type table(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+
+    async::reactor reactor;
+    size_t sum = 0;
+    consume(reactor, table, RECORDS, sum);
+
+    // 写入者在另一个进程中, 通过 header.signal 的共享 futex 唤醒 reactor
+    auto pid = ::fork();
+    if (pid == 0)
+    {
+        table_type writer(FILE_NAME, air::lightmdb::mode_t::read_write);
+        for (size_t i = 0; i < RECORDS; i++)
+            writer.push(i);
+        ::_exit(0);
+    }
+
+    reactor.run();
+    ::waitpid(pid, nullptr, 0);
+    ASSERT_EQ(sum, RECORDS * (RECORDS - 1) / 2);
+
+    air::lightmdb::remove(FILE_NAME);
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include <filesystem>
+#include <random>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include <benchmark/benchmark.h>
+
+#include "air/lightmdb/fixed.hpp"
+#include "air/lightmdb/columnar.hpp"
+
+using namespace air::lightmdb;
+constexpr auto ROW_NAME = "columnar_row.db";
+constexpr auto COLUMN_NAME = "columnar_column.db";
+/// 扫描的数据条数
+constexpr std::size_t RECORDS = 1 << 22;
+
+struct tick
+{
+    std::uint64_t time;
+    double price;
+    double volume;
+    std::int32_t side;
+    std::int32_t venue;
+};
+
+using column_table = columnar::table<tick, &tick::time, &tick::price, &tick::volume, &tick::side, &tick::venue>;
+
+static void Setup(const benchmark::State &)
+{
+    fixed::table<tick> rows(ROW_NAME, air::lightmdb::mode_t::create_only, RECORDS);
+    column_table columns(COLUMN_NAME, air::lightmdb::mode_t::create_only, RECORDS);
+    std::mt19937_64 engine(42);
+    for (std::uint64_t i = 0; i < RECORDS; ++i)
+    {
+        tick val{i, double(engine() % 10000) / 100, double(engine() % 100), std::int32_t(engine() % 2), std::int32_t(engine() % 16)};
+        rows.push(val);
+        columns.push(val);
+    }
+}
+
+static void Teardown(const benchmark::State &)
+{
+    std::filesystem::remove(ROW_NAME);
+    std::filesystem::remove(COLUMN_NAME);
+    for (std::size_t i = 0; i < 5; ++i)
+        std::filesystem::remove(std::string(COLUMN_NAME) + "f" + std::to_string(i));
+}
+
+/// 逐行读取 fixed::table 中的一个字段求和, 每行读取整个 tick
+static void row_sum(benchmark::State &state)
+{
+    fixed::table<tick> table(ROW_NAME, air::lightmdb::mode_t::read_only);
+    for (auto _ : state)
+    {
+        double sum = 0;
+        for (std::size_t i = 0; i < RECORDS; ++i)
+            sum += table[i].price;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * RECORDS);
+}
+BENCHMARK(row_sum)->Setup(Setup)->Teardown(Teardown);
+
+static void column_sum(benchmark::State &state)
+{
+    column_table table(COLUMN_NAME, air::lightmdb::mode_t::read_only);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(table.sum<&tick::price>(0, RECORDS));
+    state.SetItemsProcessed(state.iterations() * RECORDS);
+}
+BENCHMARK(column_sum)->Setup(Setup)->Teardown(Teardown);
+
+static void row_max(benchmark::State &state)
+{
+    fixed::table<tick> table(ROW_NAME, air::lightmdb::mode_t::read_only);
+    for (auto _ : state)
+    {
+        auto max = table[0].price;
+        for (std::size_t i = 1; i < RECORDS; ++i)
+            max = (std::max)(max, table[i].price);
+        benchmark::DoNotOptimize(max);
+    }
+    state.SetItemsProcessed(state.iterations() * RECORDS);
+}
+BENCHMARK(row_max)->Setup(Setup)->Teardown(Teardown);
+
+static void column_max(benchmark::State &state)
+{
+    column_table table(COLUMN_NAME, air::lightmdb::mode_t::read_only);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(table.max<&tick::price>(0, RECORDS));
+    state.SetItemsProcessed(state.iterations() * RECORDS);
+}
+BENCHMARK(column_max)->Setup(Setup)->Teardown(Teardown);
+
+/// 过滤 venue == 3 的行, 约 1/16 的行满足条件
+static void row_filter(benchmark::State &state)
+{
+    fixed::table<tick> table(ROW_NAME, air::lightmdb::mode_t::read_only);
+    for (auto _ : state)
+    {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < RECORDS; ++i)
+        {
+            if (table[i].venue == 3)
+                count += i;
+        }
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetItemsProcessed(state.iterations() * RECORDS);
+}
+BENCHMARK(row_filter)->Setup(Setup)->Teardown(Teardown);
+
+static void column_filter(benchmark::State &state)
+{
+    column_table table(COLUMN_NAME, air::lightmdb::mode_t::read_only);
+    for (auto _ : state)
+    {
+        std::size_t count = 0;
+        table.scan<&tick::venue>(0, RECORDS, compare_t::equal, 3, [&](std::size_t i)
+                                 { count += i; });
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetItemsProcessed(state.iterations() * RECORDS);
+}
+BENCHMARK(column_filter)->Setup(Setup)->Teardown(Teardown);
+
+/// 只统计满足条件的行数, 列式扫描不需要逐行回调
+static void column_count(benchmark::State &state)
+{
+    column_table table(COLUMN_NAME, air::lightmdb::mode_t::read_only);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(table.count<&tick::side>(0, RECORDS, compare_t::equal, 1));
+    state.SetItemsProcessed(state.iterations() * RECORDS);
+}
+BENCHMARK(column_count)->Setup(Setup)->Teardown(Teardown);
+
+BENCHMARK_MAIN();
\ No newline at end of file
@@ -0,0 +1,411 @@
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "air/lightmdb/columnar.hpp"
+
+using namespace air::lightmdb;
+constexpr auto FILE_NAME = "columnar.db";
+
+struct tick
+{
+    std::uint64_t time;
+    double price;
+    float volume;
+    std::int32_t side;
+    std::int8_t flag;
+    std::uint16_t venue;
+};
+
+using tick_table = columnar::table<tick, &tick::time, &tick::price, &tick::volume, &tick::side, &tick::flag, &tick::venue>;
+
+static void remove_table(std::string_view name, size_t columns)
+{
+    air::lightmdb::remove(name);
+    for (size_t i = 0; i < columns; i++)
+        air::lightmdb::remove(std::string(name) + "f" + std::to_string(i));
+}
+
+static tick make_tick(std::mt19937_64 &random, std::uint64_t time)
+{
+    tick val{};
+    val.time = time;
+    val.price = double(random() % 100000) / 100 - 500;
+    val.volume = float(random() % 1000) / 8;
+    val.side = std::int32_t(random() % 2001) - 1000;
+    val.flag = std::int8_t(random() % 256 - 128);
+    val.venue = std::uint16_t(random());
+    return val;
+}
+
+template <typename T, typename Pred>
+static void expect_field(tick_table &table, const std::vector<tick> &ticks, T tick::*field, size_t first, size_t last, compare_t op, T value, Pred pred)
+{
+    std::vector<size_t> expect;
+    for (size_t i = first; i < (std::min)(last, ticks.size()); i++)
+    {
+        if (pred(ticks[i].*field, value))
+            expect.push_back(i);
+    }
+
+    std::vector<size_t> result;
+    auto push = [&](size_t index)
+    { result.push_back(index); };
+    if constexpr (std::is_same_v<T, std::uint64_t>)
+    {
+        ASSERT_EQ(table.count<&tick::time>(first, last, op, value), expect.size());
+        table.scan<&tick::time>(first, last, op, value, push);
+    }
+    else if constexpr (std::is_same_v<T, double>)
+    {
+        ASSERT_EQ(table.count<&tick::price>(first, last, op, value), expect.size());
+        table.scan<&tick::price>(first, last, op, value, push);
+    }
+    else if constexpr (std::is_same_v<T, float>)
+    {
+        ASSERT_EQ(table.count<&tick::volume>(first, last, op, value), expect.size());
+        table.scan<&tick::volume>(first, last, op, value, push);
+    }
+    else if constexpr (std::is_same_v<T, std::int32_t>)
+    {
+        ASSERT_EQ(table.count<&tick::side>(first, last, op, value), expect.size());
+        table.scan<&tick::side>(first, last, op, value, push);
+    }
+    else if constexpr (std::is_same_v<T, std::int8_t>)
+    {
+        ASSERT_EQ(table.count<&tick::flag>(first, last, op, value), expect.size());
+        table.scan<&tick::flag>(first, last, op, value, push);
+    }
+    else
+    {
+        ASSERT_EQ(table.count<&tick::venue>(first, last, op, value), expect.size());
+        table.scan<&tick::venue>(first, last, op, value, push);
+    }
+    ASSERT_EQ(result, expect);
+}
+
+TEST(columnar_table, push)
+{
+    tick_table table(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+    ASSERT_EQ(table.capacity(), 8);
+    ASSERT_TRUE(table.empty());
+
+    std::mt19937_64 random(1);
+    std::vector<tick> ticks;
+    for (size_t i = 0; i < 1000; i++)
+    {
+        ticks.push_back(make_tick(random, i));
+        ASSERT_EQ(table.push(ticks.back()), i);
+    }
+    ASSERT_EQ(table.size(), 1000);
+    ASSERT_EQ(table.committed(), 1000);
+    ASSERT_GE(table.capacity(), 1000);
+    ASSERT_TRUE(table.has_value(999));
+    ASSERT_FALSE(table.has_value(1000));
+
+    // 其他进程从各列组装行
+    tick_table reader(FILE_NAME, air::lightmdb::mode_t::read_only);
+    for (size_t i = 0; i < 1000; i++)
+    {
+        auto val = reader[i];
+        ASSERT_EQ(val.time, ticks[i].time);
+        ASSERT_EQ(val.price, ticks[i].price);
+        ASSERT_EQ(val.volume, ticks[i].volume);
+        ASSERT_EQ(val.side, ticks[i].side);
+        ASSERT_EQ(val.flag, ticks[i].flag);
+        ASSERT_EQ(val.venue, ticks[i].venue);
+        ASSERT_EQ(reader.get<&tick::price>(i), ticks[i].price);
+    }
+
+    // 只读映射在写入者扩容后重建映射
+    for (size_t i = 1000; i < 5000; i++)
+    {
+        ticks.push_back(make_tick(random, i));
+        table.push(ticks.back());
+    }
+    ASSERT_EQ(reader.committed(), 5000);
+    ASSERT_EQ(reader.get<&tick::time>(4999), 4999);
+    ASSERT_EQ(reader.sum<&tick::time>(0, 5000), 4999 * 5000 / 2);
+
+    remove_table(FILE_NAME, 6);
+}
+
+TEST(columnar_table, aggregate)
+{
+    tick_table table(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+    std::mt19937_64 random(2);
+    std::vector<tick> ticks;
+    for (size_t i = 0; i < 3001; i++)
+    {
+        ticks.push_back(make_tick(random, i * 7));
+        table.push(ticks.back());
+    }
+
+    // 覆盖不足一个向量的范围、未对齐的起点与尾部
+    for (auto [first, last] : std::vector<std::pair<size_t, size_t>>{{0, 0}, {0, 1}, {3, 5}, {1, 33}, {5, 300}, {0, 3001}, {17, 2999}, {100, 100000}})
+    {
+        auto end = (std::min)(last, ticks.size());
+        double price = 0, volume = 0;
+        std::int64_t side = 0, flag = 0;
+        std::uint64_t venue = 0, time = 0;
+        for (size_t i = first; i < end; i++)
+        {
+            time += ticks[i].time;
+            price += ticks[i].price;
+            volume += ticks[i].volume;
+            side += ticks[i].side;
+            flag += ticks[i].flag;
+            venue += ticks[i].venue;
+        }
+        ASSERT_EQ(table.sum<&tick::time>(first, last), time);
+        ASSERT_NEAR(table.sum<&tick::price>(first, last), price, 1e-6);
+        ASSERT_NEAR(table.sum<&tick::volume>(first, last), volume, 1e-6);
+        ASSERT_EQ(table.sum<&tick::side>(first, last), side);
+        ASSERT_EQ(table.sum<&tick::flag>(first, last), flag);
+        ASSERT_EQ(table.sum<&tick::venue>(first, last), venue);
+
+        if (first == end)
+        {
+            ASSERT_FALSE(table.min<&tick::price>(first, last));
+            ASSERT_FALSE(table.max<&tick::flag>(first, last));
+            continue;
+        }
+
+        auto expect_min = [&](auto field)
+        {
+            auto val = ticks[first].*field;
+            for (size_t i = first; i < end; i++)
+                val = (std::min)(val, ticks[i].*field);
+            return val;
+        };
+        auto expect_max = [&](auto field)
+        {
+            auto val = ticks[first].*field;
+            for (size_t i = first; i < end; i++)
+                val = (std::max)(val, ticks[i].*field);
+            return val;
+        };
+        ASSERT_EQ(table.min<&tick::time>(first, last), expect_min(&tick::time));
+        ASSERT_EQ(table.min<&tick::price>(first, last), expect_min(&tick::price));
+        ASSERT_EQ(table.min<&tick::volume>(first, last), expect_min(&tick::volume));
+        ASSERT_EQ(table.min<&tick::side>(first, last), expect_min(&tick::side));
+        ASSERT_EQ(table.min<&tick::flag>(first, last), expect_min(&tick::flag));
+        ASSERT_EQ(table.min<&tick::venue>(first, last), expect_min(&tick::venue));
+        ASSERT_EQ(table.max<&tick::time>(first, last), expect_max(&tick::time));
+        ASSERT_EQ(table.max<&tick::price>(first, last), expect_max(&tick::price));
+        ASSERT_EQ(table.max<&tick::volume>(first, last), expect_max(&tick::volume));
+        ASSERT_EQ(table.max<&tick::side>(first, last), expect_max(&tick::side));
+        ASSERT_EQ(table.max<&tick::flag>(first, last), expect_max(&tick::flag));
+        ASSERT_EQ(table.max<&tick::venue>(first, last), expect_max(&tick::venue));
+    }
+
+    remove_table(FILE_NAME, 6);
+}
+
+TEST(columnar_table, scan)
+{
+    tick_table table(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+    std::mt19937_64 random(3);
+    std::vector<tick> ticks;
+    for (size_t i = 0; i < 2049; i++)
+    {
+        ticks.push_back(make_tick(random, i % 97));
+        table.push(ticks.back());
+    }
+
+    auto check = [&](size_t first, size_t last, auto field, auto value)
+    {
+        using T = decltype(value);
+        expect_field<T>(table, ticks, field, first, last, compare_t::less, value, [](T a, T b)
+                        { return a < b; });
+        expect_field<T>(table, ticks, field, first, last, compare_t::less_equal, value, [](T a, T b)
+                        { return a <= b; });
+        expect_field<T>(table, ticks, field, first, last, compare_t::equal, value, [](T a, T b)
+                        { return a == b; });
+        expect_field<T>(table, ticks, field, first, last, compare_t::not_equal, value, [](T a, T b)
+                        { return a != b; });
+        expect_field<T>(table, ticks, field, first, last, compare_t::greater, value, [](T a, T b)
+                        { return a > b; });
+        expect_field<T>(table, ticks, field, first, last, compare_t::greater_equal, value, [](T a, T b)
+                        { return a >= b; });
+    };
+
+    for (auto [first, last] : std::vector<std::pair<size_t, size_t>>{{0, 3}, {1, 40}, {7, 2049}, {0, 10000}})
+    {
+        check(first, last, &tick::time, std::uint64_t(50));
+        check(first, last, &tick::price, ticks[5].price);
+        check(first, last, &tick::volume, 60.0f);
+        check(first, last, &tick::side, std::int32_t(-3));
+        check(first, last, &tick::flag, std::int8_t(-1));
+        check(first, last, &tick::flag, std::int8_t(127));
+        check(first, last, &tick::venue, std::uint16_t(40000));
+    }
+
+    // 8 位计数通道按块累加, 不会溢出
+    ASSERT_EQ(table.count<&tick::flag>(0, 2049, compare_t::greater_equal, std::numeric_limits<std::int8_t>::min()), 2049);
+
+    // 任意谓词逐行判断
+    std::vector<size_t> result;
+    table.scan<&tick::time>(
+        10, 500, [](std::uint64_t time)
+        { return time % 10 == 3; },
+        [&](size_t index)
+        { result.push_back(index); });
+    std::vector<size_t> expect;
+    for (size_t i = 10; i < 500; i++)
+    {
+        if (ticks[i].time % 10 == 3)
+            expect.push_back(i);
+    }
+    ASSERT_EQ(result, expect);
+
+    remove_table(FILE_NAME, 6);
+}
+
+TEST(columnar_table, multi_writer)
+{
+    using table_type = columnar::table<tick, &tick::time, &tick::side>;
+    table_type(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+
+    constexpr size_t WRITERS = 4;
+    constexpr size_t COUNT = 10000;
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < WRITERS; t++)
+    {
+        writers.emplace_back([t]()
+                             {
+            table_type table(FILE_NAME, air::lightmdb::mode_t::read_write);
+            for (size_t i = 0; i < COUNT; i++)
+            {
+                tick val{};
+                val.time = t * COUNT + i;
+                val.side = std::int32_t(t);
+                val.price = 1;
+                table.push(val);
+            } });
+    }
+    for (auto &writer : writers)
+        writer.join();
+
+    table_type table(FILE_NAME, air::lightmdb::mode_t::read_only);
+    ASSERT_EQ(table.committed(), WRITERS * COUNT);
+    ASSERT_EQ(table.sum<&tick::time>(0, WRITERS * COUNT), WRITERS * COUNT * (WRITERS * COUNT - 1) / 2);
+
+    // 每行的字段来自同一次 push, 未列出的成员不保存
+    std::set<std::uint64_t> times;
+    for (size_t i = 0; i < WRITERS * COUNT; i++)
+    {
+        auto val = table[i];
+        ASSERT_EQ(val.side, std::int32_t(val.time / COUNT));
+        ASSERT_EQ(val.price, 0);
+        times.insert(val.time);
+    }
+    ASSERT_EQ(times.size(), WRITERS * COUNT);
+    for (size_t t = 0; t < WRITERS; t++)
+        ASSERT_EQ(table.count<&tick::side>(0, WRITERS * COUNT, compare_t::equal, std::int32_t(t)), COUNT);
+
+    remove_table(FILE_NAME, 2);
+}
+
+TEST(columnar_table, options)
+{
+    air::lightmdb::options opts;
+    opts.segment = 64;
+    ASSERT_THROW(tick_table(FILE_NAME, air::lightmdb::mode_t::create_only, 8, opts), std::runtime_error);
+
+    opts.segment = 0;
+    opts.growth_step = 64;
+    ASSERT_THROW(tick_table(FILE_NAME, air::lightmdb::mode_t::create_only, 8, opts), std::runtime_error);
+}
+
+TEST(columnar_table, sync)
+{
+    // 各列没有自己的水位, 由发布状态按行数刷盘并推进各列的 durable_size
+    auto column_durable = [](size_t index)
+    {
+        detail::mmap column(std::string(FILE_NAME) + "f" + std::to_string(index), air::lightmdb::mode_t::read_only);
+        return static_cast<size_t>(column.get_header().durable_size);
+    };
+    constexpr std::array<size_t, 6> sizes = {sizeof(std::uint64_t), sizeof(double), sizeof(float), sizeof(std::int32_t), sizeof(std::int8_t), sizeof(std::uint16_t)};
+
+    std::mt19937_64 random(7);
+    {
+        // 没有刷盘线程时在调用线程中刷盘
+        tick_table table(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+        for (size_t i = 0; i < 100; i++)
+            table.push(make_tick(random, i));
+        ASSERT_EQ(table.durable_size(), 0);
+        table.sync();
+        ASSERT_EQ(table.durable_size(), 100);
+        for (size_t i = 0; i < sizes.size(); i++)
+            ASSERT_EQ(column_durable(i), 100 * sizes[i]);
+    }
+
+#if defined(__linux__)
+    {
+        // periodic: 不调用 sync, 发布状态的刷盘线程按间隔刷写所有列
+        air::lightmdb::options opts;
+        opts.durability = durability_t::periodic;
+        opts.sync_interval = 1;
+        opts.prefault = 4096;
+        tick_table table(FILE_NAME, air::lightmdb::mode_t::read_write, opts);
+        for (size_t i = 100; i < 600; i++)
+            table.push(make_tick(random, i));
+
+        for (auto begin = std::chrono::steady_clock::now(); table.durable_size() != 600;)
+        {
+            ASSERT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(10));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        for (size_t i = 0; i < sizes.size(); i++)
+            ASSERT_EQ(column_durable(i), 600 * sizes[i]);
+        ASSERT_EQ(table.get<&tick::time>(599), 599);
+    }
+#endif
+
+    remove_table(FILE_NAME, 6);
+}
+
+TEST(columnar_table, simd)
+{
+    // 各个实现与标量实现一致
+    std::mt19937_64 random(4);
+    std::vector<std::int16_t> data(1000);
+    for (auto &val : data)
+        val = std::int16_t(random());
+
+    for (size_t n : {0, 1, 7, 8, 9, 15, 16, 17, 31, 33, 1000})
+    {
+        auto ptr = data.data() + (n == 1000 ? 0 : 3);
+        ASSERT_EQ(detail::simd::sum(ptr, n), detail::simd::scalar::sum(ptr, n));
+        ASSERT_EQ((detail::simd::count<compare_t::less>(ptr, n, std::int16_t(100))), (detail::simd::scalar::count<compare_t::less>(ptr, n, std::int16_t(100))));
+        if (n != 0)
+        {
+            ASSERT_EQ(detail::simd::min(ptr, n), detail::simd::scalar::min(ptr, n));
+            ASSERT_EQ(detail::simd::max(ptr, n), detail::simd::scalar::max(ptr, n));
+        }
+#if defined(__GNUC__)
+        ASSERT_EQ(detail::simd::vectorized<16>::sum(ptr, n), detail::simd::scalar::sum(ptr, n));
+        ASSERT_EQ((detail::simd::vectorized<16>::count<compare_t::not_equal>(ptr, n, ptr[0])), (detail::simd::scalar::count<compare_t::not_equal>(ptr, n, ptr[0])));
+        if (n != 0)
+        {
+            ASSERT_EQ(detail::simd::vectorized<16>::max(ptr, n), detail::simd::scalar::max(ptr, n));
+        }
+#endif
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
\ No newline at end of file
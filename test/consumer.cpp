@@ -0,0 +1,133 @@
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <gtest/gtest.h>
+#include "air/lightmdb/fixed.hpp"
+#include "air/lightmdb/cursor.hpp"
+#include "air/lightmdb/consumer.hpp"
+
+using namespace air::lightmdb;
+constexpr auto FILE_NAME = "consumer.db";
+
+TEST(consumer, offsets)
+{
+    consumer::offsets offsets(FILE_NAME, air::lightmdb::mode_t::create_only, 4);
+    ASSERT_EQ(offsets.capacity(), 4);
+    ASSERT_FALSE(offsets.min_committed_offset());
+    ASSERT_FALSE(offsets.fetch("a"));
+
+    auto a = offsets.join("a");
+    ASSERT_EQ(offsets.join("a"), a);
+    offsets.commit(a, 100);
+    offsets.commit("b", 40);
+    offsets.commit("c", 70);
+    ASSERT_EQ(offsets.fetch("a"), 100);
+    ASSERT_EQ(offsets.fetch("b"), 40);
+    ASSERT_EQ(offsets.min_committed_offset(), 40);
+
+    // 注销的消费者不再限制最小位置, 槽位可以复用
+    ASSERT_TRUE(offsets.leave("b"));
+    ASSERT_FALSE(offsets.leave("b"));
+    ASSERT_FALSE(offsets.fetch("b"));
+    ASSERT_EQ(offsets.min_committed_offset(), 70);
+    offsets.join("d", 80);
+    offsets.join("e", 90);
+    ASSERT_THROW(offsets.join("f"), std::runtime_error);
+    ASSERT_THROW(offsets.join(std::string(consumer::offsets::max_name + 1, 'x')), std::runtime_error);
+
+    std::map<std::string, size_t> all;
+    offsets.for_each([&](std::string_view name, size_t offset)
+                     { all.emplace(name, offset); });
+    ASSERT_EQ(all, (std::map<std::string, size_t>{{"a", 100}, {"c", 70}, {"d", 80}, {"e", 90}}));
+
+    // 其他进程以只读方式查看消费延迟
+    consumer::offsets other(FILE_NAME, air::lightmdb::mode_t::read_only);
+    ASSERT_EQ(other.capacity(), 4);
+    ASSERT_EQ(other.min_committed_offset(), 70);
+    ASSERT_EQ(other.fetch("d"), 80);
+    ASSERT_THROW(other.commit("a", 0), std::runtime_error);
+
+    air::lightmdb::remove(std::string(FILE_NAME) + "c");
+}
+
+#if defined(__linux__)
+TEST(consumer, crashed_lock)
+{
+    consumer::offsets offsets(FILE_NAME, air::lightmdb::mode_t::create_only, 4);
+    offsets.join("a", 10);
+
+    // 持锁进程退出后留下的锁由下一次 join 接管
+    auto pid = ::fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0)
+        ::_exit(0);
+    ASSERT_EQ(::waitpid(pid, nullptr, 0), pid);
+    {
+        detail::mmap view(std::string(FILE_NAME) + "c", air::lightmdb::mode_t::read_write);
+        view.get_header().owner = static_cast<std::uint32_t>(pid);
+    }
+
+    auto b = offsets.join("b", 20);
+    ASSERT_EQ(offsets.fetch(b), 20);
+    ASSERT_TRUE(offsets.leave("a"));
+    ASSERT_EQ(offsets.min_committed_offset(), 20);
+
+    air::lightmdb::remove(std::string(FILE_NAME) + "c");
+}
+#endif
+
+TEST(consumer, resume)
+{
+    using table_type = fixed::table<size_t>;
+    table_type table(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+    consumer::offsets(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+    for (size_t i = 0; i < 1000; i++)
+        table.push(i);
+
+    // 每个读者读取一部分后退出, 重启后从提交的位置继续
+    constexpr size_t READERS = 4;
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < READERS; t++)
+    {
+        readers.emplace_back([t]()
+                             {
+            size_t expect = 0;
+            for (size_t round = 0; round < 10; round++)
+            {
+                consumer::offsets offsets(FILE_NAME, air::lightmdb::mode_t::read_write);
+                auto name = "reader" + std::to_string(t);
+                table_type table(FILE_NAME, air::lightmdb::mode_t::read_only);
+                cursor<table_type> reader(table, offsets.fetch(name).value_or(0));
+                ASSERT_EQ(reader.position(), expect);
+
+                auto slot = offsets.join(name);
+                for (size_t i = 0; i < 10 * (t + 1); i++)
+                    ASSERT_EQ(reader.next(), expect++);
+                offsets.commit(slot, reader.position());
+            } });
+    }
+    for (auto &reader : readers)
+        reader.join();
+
+    consumer::offsets offsets(FILE_NAME, air::lightmdb::mode_t::read_only);
+    ASSERT_EQ(offsets.min_committed_offset(), 100);
+    ASSERT_EQ(offsets.fetch("reader3"), 400);
+
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "c");
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
\ No newline at end of file
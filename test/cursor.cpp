@@ -0,0 +1,180 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "air/lightmdb/fixed.hpp"
+#include "air/lightmdb/variable.hpp"
+#include "air/lightmdb/framed.hpp"
+#include "air/lightmdb/cursor.hpp"
+
+using namespace air::lightmdb;
+constexpr auto FILE_NAME = "cursor.db";
+
+template <typename WaitPolicy>
+class cursor_test : public testing::Test
+{
+};
+
+using wait_policies = testing::Types<wait::busy_spin, wait::spin_yield, wait::spin_block, wait::block>;
+TYPED_TEST_SUITE(cursor_test, wait_policies);
+
+TYPED_TEST(cursor_test, fixed_table)
+{
+    fixed::table<size_t>(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+
+    std::thread writer([]()
+                       {
+        fixed::table<size_t> table(FILE_NAME, air::lightmdb::mode_t::read_write);
+        for (size_t i = 0; i < 1000; i++)
+            table.push(i); });
+
+    fixed::table<size_t> table(FILE_NAME, air::lightmdb::mode_t::read_only);
+    cursor<fixed::table<size_t>, TypeParam> reader(table);
+    for (size_t i = 0; i < 500; i++)
+        ASSERT_EQ(reader.next(), i);
+
+    size_t expect = 500;
+    while (reader.position() < 1000)
+    {
+        reader.next_batch(64, [&](size_t val)
+                          { ASSERT_EQ(val, expect++); });
+    }
+    ASSERT_EQ(expect, 1000);
+    ASSERT_FALSE(reader.ready());
+    ASSERT_EQ(reader.poll(64, [](size_t) {}), 0);
+
+    writer.join();
+    air::lightmdb::remove(FILE_NAME);
+}
+
+TYPED_TEST(cursor_test, variable_table)
+{
+    variable::table<>(FILE_NAME, air::lightmdb::mode_t::create_only, 64, 8);
+
+    std::thread writer([]()
+                       {
+        variable::table<> table(FILE_NAME, air::lightmdb::mode_t::read_write);
+        for (int64_t i = 0; i < 1000; i++)
+            table.push(&i, sizeof(i)); });
+
+    variable::table<> table(FILE_NAME, air::lightmdb::mode_t::read_only);
+    cursor<variable::table<>, TypeParam> reader(table);
+    for (int64_t i = 0; i < 1000; i++)
+    {
+        auto val = reader.next();
+        ASSERT_EQ(val.second, sizeof(i));
+        ASSERT_EQ(*(int64_t *)val.first, i);
+    }
+
+    writer.join();
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "i");
+}
+
+TYPED_TEST(cursor_test, framed_table)
+{
+    framed::table<>(FILE_NAME, air::lightmdb::mode_t::create_only, 64);
+
+    std::thread writer([]()
+                       {
+        framed::table<> table(FILE_NAME, air::lightmdb::mode_t::read_write);
+        for (int64_t i = 0; i < 1000; i++)
+            table.push(&i, sizeof(i)); });
+
+    framed::table<> table(FILE_NAME, air::lightmdb::mode_t::read_only);
+    cursor<framed::table<>, TypeParam> reader(table);
+    for (int64_t i = 0; i < 500; i++)
+    {
+        auto val = reader.next();
+        ASSERT_EQ(val.second, sizeof(i));
+        ASSERT_EQ(*(int64_t *)val.first, i);
+    }
+
+    int64_t expect = 500;
+    while (expect < 1000)
+    {
+        reader.next_batch(64, [&](std::pair<const void *, size_t> val)
+                          { ASSERT_EQ(*(const int64_t *)val.first, expect++); });
+    }
+    ASSERT_EQ(reader.position(), table.size());
+
+    writer.join();
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "x");
+}
+
+TYPED_TEST(cursor_test, chunk)
+{
+    variable::table<>(FILE_NAME, air::lightmdb::mode_t::create_only, 64, 8);
+
+    std::vector<std::thread> writers;
+    for (int64_t t = 0; t < 4; t++)
+    {
+        writers.emplace_back([t]()
+                             {
+            variable::table<> table(FILE_NAME, air::lightmdb::mode_t::read_write);
+            variable::table<>::chunk chunk(table, 16, 256);
+            for (int64_t i = 0; i < 250; i++)
+            {
+                int64_t val[2] = {t, i};
+                chunk.push(val, sizeof(val));
+            } });
+    }
+
+    // 跳过标记不会返回给读者, 每个写入者的数据保持有序
+    variable::table<> table(FILE_NAME, air::lightmdb::mode_t::read_only);
+    cursor<variable::table<>, TypeParam> reader(table);
+    std::vector<int64_t> expect(4, 0);
+    for (size_t i = 0; i < 1000; i++)
+    {
+        auto val = (const int64_t *)reader.next().first;
+        ASSERT_EQ(val[1], expect[val[0]]++);
+    }
+    ASSERT_EQ(expect, std::vector<int64_t>(4, 250));
+
+    for (auto &writer : writers)
+        writer.join();
+    ASSERT_EQ(reader.poll(64, [](auto) {}), 0);
+    ASSERT_EQ(reader.position(), table.size().first);
+
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "i");
+}
+
+TYPED_TEST(cursor_test, skip_batch)
+{
+    fixed::table<size_t> table(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+    cursor<fixed::table<size_t>, TypeParam> reader(table);
+    {
+        // 块中只写入第 0 条, 其余 7 个位置发布为跳过标记
+        fixed::table<size_t>::chunk chunk(table, 8);
+        chunk.push(0);
+    }
+    ASSERT_EQ(reader.next(), 0);
+
+    // 已就绪的位置全是跳过标记, next_batch 继续等待下一条真正的数据
+    std::thread writer([]()
+                       {
+        fixed::table<size_t> table(FILE_NAME, air::lightmdb::mode_t::read_write);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        table.push(42); });
+
+    size_t val = 0;
+    ASSERT_EQ(reader.next_batch(64, [&](size_t v)
+                                { val = v; }),
+              1);
+    ASSERT_EQ(val, 42);
+    ASSERT_EQ(reader.position(), 9);
+
+    writer.join();
+    air::lightmdb::remove(FILE_NAME);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,309 @@
+#include <filesystem>
+#include <array>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <bit>
+#include <algorithm>
+#include <thread>
+#include <new>
+
+#include <benchmark/benchmark.h>
+
+#include "air/lightmdb/fixed.hpp"
+#include "air/lightmdb/cursor.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <csignal>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// 多进程端到端延迟: fork N 个写入进程与 M 个读取进程共享同一个 table 文件
+/// 写入者在数据中写入 steady_clock 时间戳, 读者记录从 push 到读到数据的延迟 (ns)
+/// 使用 --benchmark_format=json 或 --benchmark_out=<file> 输出 JSON
+
+using namespace air::lightmdb;
+constexpr auto FILE_NAME = "e2e.db";
+/// 每个写入进程写入的数据条数
+constexpr std::size_t RECORDS = 20000;
+constexpr std::size_t MAX_READERS = 8;
+
+/// HDR 风格的对数线性直方图: 按最高位分组, 每组再线性分为 2^sub_bits 个桶, 相对误差不超过 1/2^sub_bits
+class histogram
+{
+    static constexpr int sub_bits = 5;
+    static constexpr std::uint64_t sub_mask = (std::uint64_t(1) << sub_bits) - 1;
+    static constexpr std::size_t buckets = (64 - sub_bits + 1) << sub_bits;
+
+    std::uint64_t counts_[buckets];
+    std::uint64_t total_;
+    std::uint64_t max_;
+
+    static std::size_t index(std::uint64_t val)
+    {
+        if (val <= sub_mask)
+            return val;
+
+        auto shift = std::bit_width(val) - 1 - sub_bits;
+        return ((shift + 1) << sub_bits) + ((val >> shift) & sub_mask);
+    }
+
+    /// 桶的下界
+    static std::uint64_t value(std::size_t index)
+    {
+        if (index <= sub_mask)
+            return index;
+
+        auto shift = (index >> sub_bits) - 1;
+        return ((index & sub_mask) | (sub_mask + 1)) << shift;
+    }
+
+public:
+    void clear()
+    {
+        std::fill(std::begin(counts_), std::end(counts_), 0);
+        total_ = 0;
+        max_ = 0;
+    }
+
+    void record(std::uint64_t val)
+    {
+        ++counts_[index(val)];
+        ++total_;
+        max_ = (std::max)(max_, val);
+    }
+
+    void merge(const histogram &other)
+    {
+        for (std::size_t i = 0; i < buckets; ++i)
+            counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        max_ = (std::max)(max_, other.max_);
+    }
+
+    std::uint64_t percentile(double p) const
+    {
+        auto target = static_cast<std::uint64_t>(p * total_);
+        std::uint64_t count = 0;
+        for (std::size_t i = 0; i < buckets; ++i)
+        {
+            count += counts_[i];
+            if (count > target)
+                return value(i);
+        }
+        return max_;
+    }
+
+    std::uint64_t total() const
+    {
+        return total_;
+    }
+
+    std::uint64_t max() const
+    {
+        return max_;
+    }
+};
+
+/// 父子进程共享的控制块, 位于 fork 前创建的匿名共享映射中
+struct control
+{
+    detail::atomic<std::uint32_t> ready;
+    detail::atomic<std::uint32_t> go;
+    /// 子进程异常退出前置位, 父进程不再等待它就绪
+    detail::atomic<std::uint32_t> failed;
+    histogram readers[MAX_READERS];
+};
+
+template <size_t I>
+struct record
+{
+    std::int64_t stamp;
+    std::array<char, I - sizeof(std::int64_t)> data;
+};
+
+static std::int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// 所有进程就绪后同时开始, 避免读者晚启动把排队时间算进延迟
+static void start(control &ctrl)
+{
+    ctrl.ready.fetch_add(1);
+    while (ctrl.go.load() == 0)
+        detail::pause();
+}
+
+template <size_t I, bool IsLock>
+static void writer(control &ctrl)
+{
+    fixed::table<record<I>, IsLock> table(FILE_NAME, air::lightmdb::mode_t::read_write);
+    record<I> val{};
+    start(ctrl);
+    for (std::size_t i = 0; i < RECORDS; ++i)
+    {
+        val.stamp = now();
+        table.push(val);
+    }
+}
+
+/// 只读映射的读者同样在 header.signal 上登记并阻塞, wait::block 测量的是真正的阻塞唤醒延迟, wait::spin_block 为先自旋再阻塞的折中
+template <size_t I, bool IsLock, typename Wait>
+static void reader(control &ctrl, histogram &hist, std::size_t total)
+{
+    fixed::table<record<I>, IsLock> table(FILE_NAME, air::lightmdb::mode_t::read_only);
+    cursor<fixed::table<record<I>, IsLock>, Wait> reader(table);
+    hist.clear();
+    start(ctrl);
+    for (std::size_t i = 0; i < total; ++i)
+    {
+        auto stamp = reader.next().stamp;
+        hist.record(static_cast<std::uint64_t>((std::max)(now() - stamp, std::int64_t(0))));
+    }
+}
+
+template <size_t I, bool IsLock, typename Wait>
+static void e2e_latency(benchmark::State &state)
+{
+    auto writers = static_cast<std::size_t>(state.range(0));
+    auto readers = static_cast<std::size_t>(state.range(1));
+
+    auto addr = ::mmap(nullptr, sizeof(control), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED)
+    {
+        state.SkipWithError("failed to map control block");
+        return;
+    }
+    auto &ctrl = *new (addr) control;
+    ctrl.ready = 0;
+    ctrl.go = 0;
+    ctrl.failed = 0;
+
+    for (auto _ : state)
+    {
+        fixed::table<record<I>, IsLock>(FILE_NAME, air::lightmdb::mode_t::create_only, 1024);
+
+        std::vector<pid_t> children;
+        for (std::size_t i = 0; i < readers + writers; ++i)
+        {
+            auto pid = ::fork();
+            if (pid == 0)
+            {
+                try
+                {
+                    if (i < readers)
+                        reader<I, IsLock, Wait>(ctrl, ctrl.readers[i], writers * RECORDS);
+                    else
+                        writer<I, IsLock>(ctrl);
+                }
+                catch (...)
+                {
+                    ctrl.failed = 1;
+                    ::_exit(1);
+                }
+                ::_exit(0);
+            }
+            if (pid < 0)
+                break;
+            children.push_back(pid);
+        }
+
+        while (children.size() == readers + writers && ctrl.ready.load() != readers + writers && ctrl.failed.load() == 0)
+            std::this_thread::yield();
+
+        // fork 失败或子进程出错时结束已启动的子进程, 它们还在等待开始信号或永远等不到数据
+        if (children.size() != readers + writers || ctrl.failed.load() != 0)
+        {
+            for (auto pid : children)
+            {
+                ::kill(pid, SIGKILL);
+                ::waitpid(pid, nullptr, 0);
+            }
+            std::filesystem::remove(FILE_NAME);
+            state.SkipWithError("failed to start child processes");
+            break;
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        ctrl.go = 1;
+        auto failed = false;
+        for (auto pid : children)
+        {
+            int status = 0;
+            if (::waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                failed = true;
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        state.SetIterationTime(std::chrono::duration<double>(end - begin).count());
+        std::filesystem::remove(FILE_NAME);
+        if (failed)
+        {
+            state.SkipWithError("child process failed");
+            break;
+        }
+    }
+
+    histogram hist;
+    hist.clear();
+    for (std::size_t i = 0; i < readers; ++i)
+        hist.merge(ctrl.readers[i]);
+    ::munmap(addr, sizeof(control));
+
+    state.SetItemsProcessed(writers * RECORDS);
+    state.counters["p50"] = double(hist.percentile(0.5));
+    state.counters["p99"] = double(hist.percentile(0.99));
+    state.counters["p999"] = double(hist.percentile(0.999));
+    state.counters["max"] = double(hist.max());
+}
+
+/// 参数为 {写入进程数, 读取进程数}
+static void multi_writer(benchmark::internal::Benchmark *b)
+{
+    b->ArgNames({"writers", "readers"})->Args({1, 1})->Args({2, 2})->Args({4, 1});
+}
+
+/// IsLock 为 false 时扩容不互斥, 只能有一个写入者
+static void single_writer(benchmark::internal::Benchmark *b)
+{
+    b->ArgNames({"writers", "readers"})->Args({1, 1})->Args({1, 2})->Args({1, 4});
+}
+
+/// 每个组合只运行一次
+#define E2E_BENCHMARK(I, IsLock, Wait)                            \
+    BENCHMARK(e2e_latency<I, IsLock, wait::Wait>)                 \
+        ->Apply(IsLock ? multi_writer : single_writer)            \
+        ->Iterations(1)                                           \
+        ->UseManualTime()                                         \
+        ->Unit(benchmark::kMillisecond);
+
+E2E_BENCHMARK(8, true, busy_spin)
+E2E_BENCHMARK(8, true, spin_yield)
+E2E_BENCHMARK(8, true, spin_block)
+E2E_BENCHMARK(8, true, block)
+E2E_BENCHMARK(8, false, busy_spin)
+E2E_BENCHMARK(8, false, spin_yield)
+E2E_BENCHMARK(8, false, spin_block)
+E2E_BENCHMARK(8, false, block)
+E2E_BENCHMARK(64, true, busy_spin)
+E2E_BENCHMARK(64, true, spin_yield)
+E2E_BENCHMARK(64, true, spin_block)
+E2E_BENCHMARK(64, true, block)
+E2E_BENCHMARK(64, false, busy_spin)
+E2E_BENCHMARK(64, false, spin_yield)
+E2E_BENCHMARK(64, false, spin_block)
+E2E_BENCHMARK(64, false, block)
+E2E_BENCHMARK(512, true, busy_spin)
+E2E_BENCHMARK(512, true, spin_yield)
+E2E_BENCHMARK(512, true, spin_block)
+E2E_BENCHMARK(512, true, block)
+E2E_BENCHMARK(512, false, busy_spin)
+E2E_BENCHMARK(512, false, spin_yield)
+E2E_BENCHMARK(512, false, spin_block)
+E2E_BENCHMARK(512, false, block)
+#endif
+
+BENCHMARK_MAIN();
\ No newline at end of file
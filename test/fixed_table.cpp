@@ -1,5 +1,17 @@
+#include <algorithm>
 #include <cstddef>
-#include <filesystem>
+#include <cstdint>
+#include <vector>
+#include <numeric>
+#include <thread>
+#include <chrono>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #include <gtest/gtest.h>
 #include "air/lightmdb/fixed.hpp"
@@ -36,8 +48,705 @@ TEST(fixed_table, fixed_table)
         ASSERT_EQ((*table)[i], i);
     }
 
-    std::filesystem::remove(FILE_NAME);
+    air::lightmdb::remove(FILE_NAME);
+}
+
+TEST(fixed_table, format)
+{
+    // 没有 magic 的文件 (例如旧版本 24 字节 header 的文件) 与版本不符的文件都拒绝打开
+    {
+        air::lightmdb::detail::mmap file(FILE_NAME, air::lightmdb::mode_t::create_only, 64);
+        file.get_header().magic = 0;
+    }
+    ASSERT_THROW(fixed::table<size_t>(FILE_NAME, air::lightmdb::mode_t::read_only), std::runtime_error);
+
+    air::lightmdb::remove(FILE_NAME);
+
+    {
+        air::lightmdb::detail::mmap file(FILE_NAME, air::lightmdb::mode_t::create_only, 64);
+        file.get_header().version = air::lightmdb::detail::mmap::format_version + 1;
+    }
+    ASSERT_THROW(fixed::table<size_t>(FILE_NAME, air::lightmdb::mode_t::read_write), std::runtime_error);
+    air::lightmdb::remove(FILE_NAME);
+}
+
+TEST(fixed_table, push_n)
+{
+    auto table = std::make_unique<fixed::table<size_t>>(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+
+    std::vector<size_t> values(20);
+    std::iota(values.begin(), values.end(), 0);
+
+    ASSERT_EQ(table->push_n(values.begin(), 3), 0);
+    ASSERT_EQ(table->push(values.begin() + 3, values.end()), 3);
+    ASSERT_EQ(table->push_n(values.begin(), 0), 20);
+
+    ASSERT_EQ(table->size(), 20);
+    ASSERT_EQ(table->capacity(), 32);
+    for (size_t i = 0; i < 20; i++)
+    {
+        ASSERT_TRUE(table->has_value(i));
+        ASSERT_EQ((*table)[i], i);
+    }
+
+    table.reset();
+    air::lightmdb::remove(FILE_NAME);
+}
+
+TEST(fixed_table, segment)
+{
+    air::lightmdb::options opts;
+    opts.segment = 8;
+    if (opts.backend == backend_t::memfd)
+    {
+        ASSERT_THROW(fixed::table<size_t>(FILE_NAME, air::lightmdb::mode_t::create_only, 12, opts), std::runtime_error);
+        return;
+    }
+    auto table = std::make_unique<fixed::table<size_t>>(FILE_NAME, air::lightmdb::mode_t::create_only, 12, opts);
+    ASSERT_EQ(table->capacity(), 16);
+
+    table->push(0);
+    auto first = &(*table)[0];
+    for (size_t i = 1; i < 100; i++)
+    {
+        table->push(i);
+        ASSERT_EQ((*table)[i], i);
+    }
+
+    // 扩容只追加新段, 已有数据的地址不变
+    ASSERT_EQ(first, &(*table)[0]);
+    ASSERT_EQ(table->size(), 100);
+    ASSERT_EQ(table->capacity(), 104);
+
+    table->shrink_to_fit();
+    table = std::make_unique<fixed::table<size_t>>(FILE_NAME, air::lightmdb::mode_t::read_only);
+    ASSERT_EQ(table->size(), 100);
+    ASSERT_EQ(table->capacity(), 104);
+    for (size_t i = 0; i < 100; i++)
+    {
+        ASSERT_EQ((*table)[i], i);
+    }
+
+    table.reset();
+    air::lightmdb::remove(FILE_NAME);
+    for (size_t i = 1; i < 13; i++)
+        air::lightmdb::remove(FILE_NAME + std::string(".") + std::to_string(i));
+}
+
+#if defined(__linux__)
+TEST(fixed_table, reserve)
+{
+    air::lightmdb::options opts;
+    opts.reserve = size_t(1) << 30;
+    auto table = std::make_unique<fixed::table<size_t>>(FILE_NAME, air::lightmdb::mode_t::create_only, 8, opts);
+    fixed::table<size_t> reader(FILE_NAME, air::lightmdb::mode_t::read_only, opts);
+
+    table->push(0);
+    auto first = &(*table)[0];
+    auto reader_first = &reader[0];
+    for (size_t i = 1; i < 10000; i++)
+    {
+        table->push(i);
+        ASSERT_EQ(reader[i], i);
+    }
+
+    // 扩容后基地址不变
+    ASSERT_EQ(first, &(*table)[0]);
+    ASSERT_EQ(reader_first, &reader[0]);
+    ASSERT_EQ(table->capacity(), 16384);
+
+    table->shrink_to_fit();
+    ASSERT_EQ(table->capacity(), 10000);
+    ASSERT_EQ((*table)[9999], 9999);
+
+    table.reset();
+    air::lightmdb::remove(FILE_NAME);
+}
+#endif
+
+#if defined(__linux__)
+TEST(fixed_table, backend)
+{
+    for (auto backend : {backend_t::shm, backend_t::memfd})
+    {
+        air::lightmdb::options opts;
+        opts.backend = backend;
+        fixed::table<size_t> table(FILE_NAME, air::lightmdb::mode_t::create_only, 8, opts);
+
+        // fork 的子进程继承 memfd 登记表与描述符, 按名字打开同一个 table 并扩容
+        auto pid = ::fork();
+        if (pid == 0)
+        {
+            fixed::table<size_t> writer(FILE_NAME, air::lightmdb::mode_t::read_write, opts);
+            for (size_t i = 0; i < 1000; i++)
+                writer.push(i);
+            ::_exit(0);
+        }
+        ::waitpid(pid, nullptr, 0);
+
+        ASSERT_EQ(table.size(), 1000);
+        for (size_t i = 0; i < 1000; i++)
+            ASSERT_EQ(table[i], i);
+        ASSERT_TRUE(air::lightmdb::remove(FILE_NAME, opts));
+    }
+    ASSERT_EQ(air::lightmdb::memfd(FILE_NAME), -1);
+
+    // memfd 的新段只登记在扩容的进程中, 子进程扩容后父进程无法打开, 因此拒绝分段
+    air::lightmdb::options opts;
+    opts.backend = backend_t::memfd;
+    opts.segment = 8;
+    ASSERT_THROW(fixed::table<size_t>(FILE_NAME, air::lightmdb::mode_t::create_only, 8, opts), std::runtime_error);
+    ASSERT_EQ(air::lightmdb::memfd(FILE_NAME), -1);
+}
+#endif
+
+#if defined(__linux__)
+/// [addr, addr + size) 所在页面中驻留内存的页数
+static size_t resident(const void *addr, size_t size)
+{
+    auto page = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    auto begin = reinterpret_cast<std::uintptr_t>(addr) / page * page;
+    auto end = (reinterpret_cast<std::uintptr_t>(addr) + size + page - 1) / page * page;
+    std::vector<unsigned char> pages((end - begin) / page);
+    if (::mincore(reinterpret_cast<void *>(begin), end - begin, pages.data()) != 0)
+        return 0;
+    return std::count_if(pages.begin(), pages.end(), [](unsigned char val)
+                         { return (val & 1) != 0; });
+}
+#endif
+
+TEST(fixed_table, prefault)
+{
+    air::lightmdb::options opts;
+    opts.prefault = 1 << 16;
+    // 不使用大页并以 random 关闭文件预读, mincore 只统计预取线程分配的页面
+    opts.advice = air::lightmdb::advice_t::random;
+    auto table = std::make_unique<fixed::table<size_t>>(FILE_NAME, air::lightmdb::mode_t::create_only, 1 << 16, opts);
+
+    // 写入 count 条后预取线程提前分配 [count, count + prefault) 的页面
+    constexpr size_t count = 1 << 15;
+    table->push(0);
+#if defined(__linux__)
+    constexpr size_t stride = sizeof(layout::packed::block<size_t>);
+    auto page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    auto window = reinterpret_cast<const char *>(&(*table)[0]) + count * stride;
+    auto bytes = opts.prefault - page;
+    // 预取之前这些页面超出写入位置之后的 prefault 字节, 尚未分配
+    ASSERT_EQ(resident(window, bytes), 0);
+#endif
+
+    for (size_t i = 1; i < count; i++)
+    {
+        table->push(i);
+        ASSERT_EQ((*table)[i], i);
+    }
+
+#if defined(__linux__)
+    for (auto begin = std::chrono::steady_clock::now(); resident(window, bytes) < bytes / page;)
+    {
+        ASSERT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(10));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+#endif
+
+    table->advise(0, 5000, air::lightmdb::advice_t::dontneed);
+    for (size_t i = 0; i < count; i++)
+    {
+        ASSERT_EQ((*table)[i], i);
+    }
+
+    {
+        // 私有映射被 dontneed 丢弃的页面重新读取文件内容, 可以观察到 madvise 作用的范围
+        fixed::table<size_t> view(FILE_NAME, air::lightmdb::mode_t::copy_on_write);
+        view[count - 1] = 0;
+        // 空区间与反向区间不调用 madvise; 反向区间的长度下溢时会丢弃 5000 之后的所有页面
+        view.advise(5000, 5000, air::lightmdb::advice_t::dontneed);
+        view.advise(5000, 0, air::lightmdb::advice_t::dontneed);
+        ASSERT_EQ(view[count - 1], 0);
+#if defined(__linux__)
+        view.advise(5000, count, air::lightmdb::advice_t::dontneed);
+        ASSERT_EQ(view[count - 1], count - 1);
+#endif
+    }
+
+    table.reset();
+    air::lightmdb::remove(FILE_NAME);
+}
+
+TEST(fixed_table, single_producer)
+{
+    using table_type = fixed::table<size_t, true, layout::sequence, producer_t::single>;
+    auto table = std::make_unique<table_type>(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+    auto reader = std::make_unique<fixed::table<size_t, true, layout::sequence>>(FILE_NAME, air::lightmdb::mode_t::read_write);
+
+    std::thread thread([&]() {
+        for (size_t i = 0; i < 1000; i++)
+        {
+            reader->wait(i);
+            ASSERT_EQ((*reader)[i], i);
+        }
+    });
+
+    for (size_t i = 0; i < 500; i++)
+    {
+        ASSERT_EQ(table->push(i), i);
+    }
+
+    std::vector<size_t> values(500);
+    std::iota(values.begin(), values.end(), 500);
+    ASSERT_EQ(table->push(values.begin(), values.end()), 500);
+    thread.join();
+
+    // header.size 只按 flush_interval 发布, 本地 size 总是最新的
+    ASSERT_EQ(table->size(), 1000);
+    ASSERT_LE(reader->size(), 1000);
+    table->flush();
+    ASSERT_EQ(reader->size(), 1000);
+
+    table->push(1000);
+    table.reset();
+    reader.reset();
+
+    table = std::make_unique<table_type>(FILE_NAME, air::lightmdb::mode_t::read_write);
+    ASSERT_EQ(table->size(), 1001);
+    ASSERT_EQ(table->push(1001), 1001);
+    for (size_t i = 0; i < 1002; i++)
+    {
+        ASSERT_EQ((*table)[i], i);
+    }
+
+    table.reset();
+    air::lightmdb::remove(FILE_NAME);
+}
+
+TEST(fixed_table, single_producer_recover)
+{
+    using table_type = fixed::table<size_t, true, layout::bitmap, producer_t::single>;
+
+    // 模拟单写入者崩溃: 不析构, 最后 36 条已发布但没有 flush; flush 只写了 size, 水位停在一半
+    alignas(table_type) unsigned char storage[sizeof(table_type)];
+    auto crashed = new (storage) table_type(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+    for (size_t i = 0; i < 100; i++)
+        crashed->push(i);
+    {
+        detail::mmap view(FILE_NAME, air::lightmdb::mode_t::read_write);
+        view.get_header().committed = view.get_header().size / 2;
+    }
+
+    // 恢复后写入位置越过已发布的数据, 新数据不会覆盖它们
+    air::lightmdb::options opts;
+    opts.recover = true;
+    table_type table(FILE_NAME, air::lightmdb::mode_t::read_write, opts);
+    ASSERT_EQ(table.size(), 100);
+    ASSERT_EQ(table.committed(), 100);
+    ASSERT_EQ(table.recover(), 0);
+    ASSERT_EQ(table.push(100), 100);
+    for (size_t i = 0; i <= 100; i++)
+        ASSERT_EQ(table[i], i);
+
+    air::lightmdb::remove(FILE_NAME);
+}
+
+TEST(fixed_table, read_only_wait)
+{
+    using table_type = fixed::table<size_t, true, layout::sequence>;
+    table_type(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+
+    std::thread thread([]()
+                       {
+        table_type table(FILE_NAME, air::lightmdb::mode_t::read_write);
+        for (size_t i = 0; i < 1000; i++)
+            table.push(i); });
+
+    // 只读映射通过独立的可写 header 视图登记为等待者, 由写入者唤醒
+    table_type reader(FILE_NAME, air::lightmdb::mode_t::read_only);
+    for (size_t i = 0; i < 1000; i++)
+    {
+        reader.wait(i);
+        ASSERT_EQ(reader[i], i);
+    }
+    thread.join();
+
+    // 私有映射同样在共享的 header 上登记并阻塞, 写入者看到 waiters 后唤醒
+    for (auto mode : {air::lightmdb::mode_t::read_only, air::lightmdb::mode_t::read_private, air::lightmdb::mode_t::copy_on_write})
+    {
+        table_type blocked(FILE_NAME, mode);
+        table_type writer(FILE_NAME, air::lightmdb::mode_t::read_write);
+        detail::mmap view(FILE_NAME, air::lightmdb::mode_t::read_only);
+        auto index = writer.size();
+        std::thread waiter([&]()
+                           { blocked.wait(index); });
+
+        // 没有原生 futex 时读者轮询, 不登记 waiters
+        while (detail::atomic<std::uint32_t>::always_has_native_wait_notify && view.get_header().waiters.load() == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        writer.push(index);
+        waiter.join();
+        ASSERT_EQ(view.get_header().waiters.load(), 0);
+        if constexpr (detail::atomic<std::uint32_t>::always_has_native_wait_notify)
+        {
+            ASSERT_GT(view.get_header().signal.load(), 0);
+        }
+    }
+
+    air::lightmdb::remove(FILE_NAME);
+}
+
+TEST(fixed_table, sync)
+{
+    using table_type = fixed::table<size_t>;
+    {
+        // 没有刷盘线程时在调用线程中刷盘
+        table_type table(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+        for (size_t i = 0; i < 100; i++)
+            table.push(i);
+        ASSERT_EQ(table.durable_size(), 0);
+        table.sync();
+        ASSERT_EQ(table.durable_size(), 100);
+    }
+
+#if defined(__linux__)
+    {
+        // group_commit: 多个写入者的 sync 由刷盘线程合并完成
+        air::lightmdb::options opts;
+        opts.durability = durability_t::group_commit;
+        table_type table(FILE_NAME, air::lightmdb::mode_t::read_write, opts);
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < 4; t++)
+        {
+            threads.emplace_back([&]()
+                                 {
+                table_type writer(FILE_NAME, air::lightmdb::mode_t::read_write);
+                for (size_t i = 0; i < 100; i++)
+                {
+                    // durable_size 只计入连续已发布的数据, 其他写入者已占用未发布的位置可能使它停在 index 之前
+                    writer.push(i);
+                    auto committed = writer.committed();
+                    writer.sync();
+                    ASSERT_GE(writer.durable_size(), committed);
+                } });
+        }
+        for (auto &thread : threads)
+            thread.join();
+        ASSERT_EQ(table.durable_size(), 500);
+    }
+
+    {
+        // periodic: 不调用 sync, 刷盘线程按间隔推进 durable_size
+        air::lightmdb::options opts;
+        opts.durability = durability_t::periodic;
+        opts.sync_interval = 1;
+        table_type table(FILE_NAME, air::lightmdb::mode_t::read_write, opts);
+        for (size_t i = 0; i < 100; i++)
+            table.push(i);
+
+        for (auto begin = std::chrono::steady_clock::now(); table.durable_size() != 600;)
+        {
+            ASSERT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(10));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+#endif
+
+    air::lightmdb::remove(FILE_NAME);
+}
+
+template <typename Layout>
+class fixed_table_layout : public testing::Test
+{
+};
+
+using layouts = testing::Types<layout::packed, layout::aligned, layout::sequence, layout::bitmap>;
+TYPED_TEST_SUITE(fixed_table_layout, layouts);
+
+TYPED_TEST(fixed_table_layout, layout)
+{
+    using table_type = fixed::table<size_t, true, TypeParam>;
+    auto table = std::make_unique<table_type>(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+    ASSERT_EQ(table->size(), 0);
+    ASSERT_GE(table->capacity(), 8);
+
+    for (size_t i = 0; i < 100; i++)
+    {
+        table->push(i);
+        ASSERT_EQ((*table)[i], i);
+    }
+
+    std::vector<size_t> values(100);
+    std::iota(values.begin(), values.end(), 100);
+    ASSERT_EQ(table->push(values.begin(), values.end()), 100);
+
+    ASSERT_EQ(table->size(), 200);
+    ASSERT_TRUE(table->has_value(199));
+    ASSERT_FALSE(table->has_value(200));
+    ASSERT_EQ(table->available(0, 1000), 200);
+    ASSERT_EQ(table->available(150, 10), 10);
+
+    table->shrink_to_fit();
+    table = std::make_unique<table_type>(FILE_NAME, air::lightmdb::mode_t::read_only);
+    ASSERT_EQ(table->size(), 200);
+    ASSERT_GE(table->capacity(), 200);
+    for (size_t i = 0; i < 200; i++)
+    {
+        ASSERT_EQ((*table)[i], i);
+    }
+
+    table.reset();
+    air::lightmdb::remove(FILE_NAME);
+}
+
+TYPED_TEST(fixed_table_layout, chunk)
+{
+    using table_type = fixed::table<size_t, true, TypeParam>;
+    table_type(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < 4; t++)
+    {
+        writers.emplace_back([t]()
+                             {
+            table_type table(FILE_NAME, air::lightmdb::mode_t::read_write);
+            typename table_type::chunk chunk(table, 16);
+            for (size_t i = 0; i < 100; i++)
+                chunk.push(t << 32 | i); });
+    }
+    for (auto &writer : writers)
+        writer.join();
+
+    // 每个写入者最后一块剩余 12 个位置被标记为跳过
+    table_type table(FILE_NAME, air::lightmdb::mode_t::read_write);
+    ASSERT_EQ(table.size(), 4 * 112);
+    ASSERT_EQ(table.available(0, 1000), 4 * 112);
+
+    std::vector<size_t> expect(4, 0);
+    size_t skipped = 0;
+    for (size_t i = 0; i < table.size(); i++)
+    {
+        ASSERT_TRUE(table.has_value(i));
+        if (table.skipped(i))
+        {
+            ++skipped;
+            continue;
+        }
+        auto val = table[i];
+        ASSERT_EQ(val & 0xffffffff, expect[val >> 32]++);
+    }
+    ASSERT_EQ(skipped, 4 * 12);
+    ASSERT_EQ(expect, std::vector<size_t>(4, 100));
+
+    air::lightmdb::remove(FILE_NAME);
+}
+
+TYPED_TEST(fixed_table_layout, recover)
+{
+    using table_type = fixed::table<size_t, true, TypeParam>;
+    {
+        table_type table(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+        for (size_t i = 0; i < 100; i++)
+            table.push(i);
+        ASSERT_EQ(table.committed(), 100);
+
+        // 模拟写入者崩溃: 占用 16 个位置只写入 1 个, 不析构 chunk
+        alignas(typename table_type::chunk) unsigned char storage[sizeof(typename table_type::chunk)];
+        auto chunk = new (storage) typename table_type::chunk(table, 16);
+        chunk->push(100);
+
+        for (size_t i = 0; i < 100; i++)
+            table.push(i + 1000);
+        ASSERT_EQ(table.size(), 216);
+        ASSERT_EQ(table.committed(), 101);
+        ASSERT_EQ(table.available(0, 1000), 101);
+    }
+
+    air::lightmdb::options opts;
+    opts.recover = true;
+    table_type table(FILE_NAME, air::lightmdb::mode_t::read_write, opts);
+    ASSERT_EQ(table.committed(), 216);
+    ASSERT_EQ(table.available(0, 1000), 216);
+    ASSERT_EQ(table.recover(), 0);
+
+    for (size_t i = 101; i < 116; i++)
+        ASSERT_TRUE(table.skipped(i));
+    ASSERT_FALSE(table.skipped(100));
+    ASSERT_EQ(table[215], 1099);
+
+    air::lightmdb::remove(FILE_NAME);
+}
+
+TEST(fixed_table, sequence_stamp)
+{
+    // 序号记录位置是为哪个下标写入的, 同一位置上其他下标 (相差 slots 的整数倍) 的序号不算已发布
+    using block_type = layout::sequence::block<size_t>;
+    auto block = std::make_unique<block_type>();
+    block->store(3, 42);
+    ASSERT_TRUE(block->has_value(3));
+    ASSERT_FALSE(block->skipped(3));
+    ASSERT_FALSE(block->has_value(3 + block_type::slots));
+    ASSERT_EQ(block->value(3), 42);
+
+    block->skip(4);
+    ASSERT_TRUE(block->has_value(4));
+    ASSERT_TRUE(block->skipped(4));
+    ASSERT_FALSE(block->has_value(4 + block_type::slots));
+
+    ASSERT_EQ(block->ready(3), 2);
+    ASSERT_EQ(block->ready(3 + block_type::slots), 0);
+    ASSERT_EQ(block->ready(2), 0);
+}
+
+TEST(fixed_table, committed)
+{
+    using table_type = fixed::table<size_t>;
+    table_type(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+
+    // 多个写入者交错发布, 水位最终追上 size
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < 4; t++)
+    {
+        writers.emplace_back([]()
+                             {
+            table_type table(FILE_NAME, air::lightmdb::mode_t::read_write);
+            for (size_t i = 0; i < 1000; i++)
+                table.push(i); });
+    }
+    for (auto &writer : writers)
+        writer.join();
+
+    table_type table(FILE_NAME, air::lightmdb::mode_t::read_only);
+    ASSERT_EQ(table.committed(), 4000);
+    ASSERT_EQ(table.available(0, 10000), 4000);
+
+    using single_type = fixed::table<size_t, true, layout::packed, producer_t::single>;
+    {
+        single_type writer(FILE_NAME, air::lightmdb::mode_t::read_write);
+        writer.push(0);
+        ASSERT_EQ(table.committed(), 4000);
+        writer.flush();
+        ASSERT_EQ(table.committed(), 4001);
+    }
+
+    air::lightmdb::remove(FILE_NAME);
+}
+
+TEST(fixed_table, growth)
+{
+    // 线性增长, 每次增加约 512 字节
+    air::lightmdb::options opts;
+    opts.growth_step = 64 * sizeof(size_t);
+    {
+        fixed::table<size_t> table(FILE_NAME, air::lightmdb::mode_t::create_only, 8, opts);
+        std::vector<size_t> capacity{table.capacity()};
+        for (size_t i = 0; capacity.size() < 4; i++)
+        {
+            table.push(i);
+            if (table.capacity() != capacity.back())
+                capacity.push_back(table.capacity());
+        }
+        ASSERT_LE(capacity[1] - capacity[0], 64);
+        ASSERT_EQ(capacity[2] - capacity[1], capacity[1] - capacity[0]);
+        ASSERT_EQ(capacity[3] - capacity[2], capacity[1] - capacity[0]);
+    }
+
+    // 越过阈值后由后台线程扩容, 不需要写入者越过 capacity
+    opts.growth_threshold = 0.5;
+    {
+        fixed::table<size_t> table(FILE_NAME, air::lightmdb::mode_t::create_only, 1024, opts);
+        for (size_t i = 0; i < 600; i++)
+            table.push(i);
+
+        size_t capacity = 0;
+        for (size_t i = 0; i < 1000 && capacity < 1024 + 64; i++)
+        {
+            capacity = fixed::table<size_t>(FILE_NAME, air::lightmdb::mode_t::read_only).capacity();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT_GE(capacity, 1024 + 64);
+        ASSERT_EQ(table.capacity(), 1024);
+    }
+
+    // 多个写入者与后台扩容并发
+    {
+        using table_type = fixed::table<size_t>;
+        table_type(FILE_NAME, air::lightmdb::mode_t::create_only, 8, opts);
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < 4; t++)
+        {
+            writers.emplace_back([&opts]()
+                                 {
+                table_type table(FILE_NAME, air::lightmdb::mode_t::read_write, opts);
+                for (size_t i = 0; i < 10000; i++)
+                    table.push(i); });
+        }
+        for (auto &writer : writers)
+            writer.join();
+
+        table_type table(FILE_NAME, air::lightmdb::mode_t::read_only);
+        size_t sum = 0;
+        for (size_t i = 0; i < table.size(); i++)
+            sum += table[i];
+        ASSERT_EQ(table.size(), 40000);
+        ASSERT_EQ(sum, 4 * (10000 * 9999 / 2));
+    }
+
+    // 写入者不加锁扩容的 table 不能使用后台扩容
+    using unlocked_type = fixed::table<size_t, false>;
+    ASSERT_THROW(unlocked_type(FILE_NAME, air::lightmdb::mode_t::create_only, 8, opts), std::runtime_error);
+    opts.growth_threshold = 2;
+    ASSERT_THROW(fixed::table<size_t>(FILE_NAME, air::lightmdb::mode_t::create_only, 8, opts), std::runtime_error);
+
+    air::lightmdb::remove(FILE_NAME);
+}
+
+#if defined(__linux__)
+/// 文件实际占用的字节数
+static size_t allocated(const std::string &name)
+{
+    struct stat st;
+    if (::stat(detail::backend_path(name, detail::default_backend, false).c_str(), &st) != 0)
+        return 0;
+    return static_cast<size_t>(st.st_blocks) * 512;
+}
+
+TEST(fixed_table, discard)
+{
+    for (size_t segment : {size_t(0), size_t(4096)})
+    {
+        air::lightmdb::options opts;
+        opts.segment = segment;
+        if (segment != 0 && opts.backend == backend_t::memfd)
+            continue;
+        fixed::table<size_t> table(FILE_NAME, air::lightmdb::mode_t::create_only, 1 << 17, opts);
+        for (size_t i = 0; i < 100000; i++)
+            table.push(i);
+        auto before = allocated(FILE_NAME);
+
+        ASSERT_TRUE(table.discard_before(50000));
+        ASSERT_EQ(table.discarded(), 50000);
+        ASSERT_TRUE(table.discard_before(90000));
+        ASSERT_TRUE(table.discard_before(10));
+        ASSERT_EQ(table.discarded(), 90000);
+
+        // 下标不变, 未释放的数据照常读取
+        ASSERT_EQ(table.size(), 100000);
+        for (size_t i = 90000; i < 100000; i++)
+            ASSERT_EQ(table[i], i);
+        table.push(100000);
+        ASSERT_EQ(table[100000], 100000);
+
+        // 被释放的数据读出为 0
+        ASSERT_EQ(table[50000], 0);
+        if (segment == 0)
+        {
+            ASSERT_LE(allocated(FILE_NAME) + 90000 * sizeof(size_t) - 8192, before);
+        }
+
+        air::lightmdb::remove(FILE_NAME);
+        for (size_t i = 1; i < 32; i++)
+            air::lightmdb::remove(FILE_NAME + std::string(".") + std::to_string(i));
+    }
 }
+#endif
 
 int main(int argc, char **argv)
 {
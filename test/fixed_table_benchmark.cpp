@@ -1,6 +1,7 @@
 #include <thread>
 #include <filesystem>
 #include <array>
+#include <vector>
 
 #include <benchmark/benchmark.h>
 
@@ -8,7 +9,7 @@
 
 using namespace air::lightmdb;
 constexpr auto FILE_NAME = "table.db";
-static auto THREADS = 16 > std::thread::hardware_concurrency() ? 16 : std::thread::hardware_concurrency();
+static auto THREADS = 32 > std::thread::hardware_concurrency() ? 32 : std::thread::hardware_concurrency();
 
 template <size_t I>
 static void DoSetup(const benchmark::State &state)
@@ -31,7 +32,7 @@ static void fixed_table(benchmark::State &state)
     std::array<char, I> i;
     for (auto _ : state)
     {
-        auto c = table.push(i);
+        table.push(i);
         i[0] += 1;
     }
 }
@@ -40,4 +41,53 @@ BENCHMARK(fixed_table<16>)->ThreadRange(1, THREADS)->Setup(DoSetup<16>)->Teardow
 BENCHMARK(fixed_table<32>)->ThreadRange(1, THREADS)->Setup(DoSetup<32>)->Teardown(DoTeardown);
 BENCHMARK(fixed_table<64>)->ThreadRange(1, THREADS)->Setup(DoSetup<64>)->Teardown(DoTeardown);
 
+template <size_t I>
+static void fixed_table_batch(benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    fixed::table<std::array<char, I>> table(file, air::lightmdb::mode_t::read_write);
+    std::vector<std::array<char, I>> batch(state.range(0));
+    for (auto _ : state)
+    {
+        table.push_n(batch.begin(), batch.size());
+        batch[0][0] += 1;
+    }
+    state.SetItemsProcessed(state.iterations() * batch.size());
+}
+BENCHMARK(fixed_table_batch<8>)->RangeMultiplier(8)->Range(1, 64)->ThreadRange(1, THREADS)->Setup(DoSetup<8>)->Teardown(DoTeardown);
+BENCHMARK(fixed_table_batch<64>)->RangeMultiplier(8)->Range(1, 64)->ThreadRange(1, THREADS)->Setup(DoSetup<64>)->Teardown(DoTeardown);
+
+template <size_t I>
+static void fixed_table_chunk(benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    fixed::table<std::array<char, I>> table(file, air::lightmdb::mode_t::read_write);
+    typename fixed::table<std::array<char, I>>::chunk chunk(table, state.range(0));
+    std::array<char, I> i;
+    for (auto _ : state)
+    {
+        chunk.push(i);
+        i[0] += 1;
+    }
+}
+BENCHMARK(fixed_table_chunk<8>)->Arg(64)->ThreadRange(1, THREADS)->Setup(DoSetup<8>)->Teardown(DoTeardown);
+BENCHMARK(fixed_table_chunk<64>)->Arg(64)->ThreadRange(1, THREADS)->Setup(DoSetup<64>)->Teardown(DoTeardown);
+
+template <size_t I>
+static void fixed_table_single(benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    fixed::table<std::array<char, I>, true, layout::packed, producer_t::single> table(file, air::lightmdb::mode_t::read_write);
+    std::array<char, I> i;
+    for (auto _ : state)
+    {
+        table.push(i);
+        i[0] += 1;
+    }
+}
+BENCHMARK(fixed_table_single<8>)->Setup(DoSetup<8>)->Teardown(DoTeardown);
+BENCHMARK(fixed_table_single<16>)->Setup(DoSetup<16>)->Teardown(DoTeardown);
+BENCHMARK(fixed_table_single<32>)->Setup(DoSetup<32>)->Teardown(DoTeardown);
+BENCHMARK(fixed_table_single<64>)->Setup(DoSetup<64>)->Teardown(DoTeardown);
+
 BENCHMARK_MAIN();
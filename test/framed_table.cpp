@@ -0,0 +1,229 @@
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "air/lightmdb/framed.hpp"
+
+using namespace air::lightmdb;
+constexpr auto FILE_NAME = "table.db";
+
+static void remove_table()
+{
+    std::filesystem::remove(FILE_NAME);
+    std::filesystem::remove(std::string(FILE_NAME) + "x");
+}
+
+TEST(framed_table, framed_table)
+{
+    using table_type = framed::table<true, 4>;
+    auto table = std::make_unique<table_type>(FILE_NAME, air::lightmdb::mode_t::create_only, 64);
+
+    ASSERT_TRUE(table->empty());
+    ASSERT_FALSE(table->has_value(0));
+
+    // 长度 1..100 的字符串, 帧按 8 字节对齐
+    std::vector<size_t> offsets;
+    for (size_t i = 1; i <= 100; i++)
+    {
+        std::string val(i, char('a' + i % 26));
+        offsets.push_back(table->push(val.data(), val.size()));
+    }
+
+    ASSERT_EQ(offsets[0], 0);
+    ASSERT_EQ(offsets[1], 16);
+    ASSERT_EQ(table->size(), offsets.back() + 8 + 104);
+    for (size_t i = 0; i < 100; i++)
+    {
+        ASSERT_TRUE(table->has_value(offsets[i]));
+        auto val = (*table)[offsets[i]];
+        ASSERT_EQ(val.second, i + 1);
+        ASSERT_EQ(std::string((const char *)val.first, val.second), std::string(i + 1, char('a' + (i + 1) % 26)));
+        if (i + 1 < 100)
+        {
+            ASSERT_EQ(table->next(offsets[i]), offsets[i + 1]);
+        }
+    }
+    ASSERT_FALSE(table->has_value(table->size()));
+
+    {
+        // 写入者每提交 Interval 帧扩展一次稀疏索引, 只读映射不必自己构建
+        table_type reader(FILE_NAME, air::lightmdb::mode_t::read_only);
+        ASSERT_EQ(reader.index(), 26);
+        for (size_t i = 0; i < 100; i++)
+            ASSERT_EQ(reader.seek(i), offsets[i]);
+    }
+
+    ASSERT_EQ(table->index(), 26);
+    for (size_t i = 0; i < 100; i++)
+        ASSERT_EQ(table->seek(i), offsets[i]);
+
+    table->shrink_to_fit();
+    table = std::make_unique<table_type>(FILE_NAME, air::lightmdb::mode_t::read_only);
+    ASSERT_EQ(table->capacity(), table->size());
+    for (size_t i = 0; i < 100; i++)
+    {
+        ASSERT_EQ(table->seek(i), offsets[i]);
+        ASSERT_EQ((*table)[offsets[i]].second, i + 1);
+    }
+
+    table.reset();
+    remove_table();
+}
+
+TEST(framed_table, reserve_commit)
+{
+    auto table = std::make_unique<framed::table<>>(FILE_NAME, air::lightmdb::mode_t::create_only, 16);
+
+    auto first = table->reserve(sizeof(int64_t));
+    auto second = table->reserve(sizeof(int64_t));
+    ASSERT_EQ(first.offset, 0);
+    ASSERT_EQ(second.offset, 16);
+
+    *(int64_t *)second.data = 2;
+    ASSERT_EQ(table->commit(second), 16);
+    ASSERT_FALSE(table->has_value(0));
+    ASSERT_TRUE(table->has_value(16));
+
+    *(int64_t *)first.data = 1;
+    table->commit(first);
+    ASSERT_EQ(*(int64_t *)(*table)[0].first, 1);
+    ASSERT_EQ(*(int64_t *)(*table)[16].first, 2);
+
+    table.reset();
+    remove_table();
+}
+
+TEST(framed_table, concurrent)
+{
+    framed::table<true, 16>(FILE_NAME, air::lightmdb::mode_t::create_only, 64);
+
+    std::vector<std::thread> writers;
+    for (int64_t t = 0; t < 4; t++)
+    {
+        writers.emplace_back([t]()
+                             {
+            framed::table<true, 16> table(FILE_NAME, air::lightmdb::mode_t::read_write);
+            for (int64_t i = 0; i < 1000; i++)
+            {
+                int64_t val[2] = {t, i};
+                table.push(val, sizeof(val));
+            } });
+    }
+
+    framed::table<true, 16> table(FILE_NAME, air::lightmdb::mode_t::read_write);
+    std::vector<int64_t> expect(4, 0);
+    size_t offset = 0;
+    for (size_t i = 0; i < 4000; i++)
+    {
+        table.wait(offset);
+        auto val = table[offset];
+        ASSERT_EQ(val.second, 2 * sizeof(int64_t));
+        auto data = (const int64_t *)val.first;
+        ASSERT_EQ(data[1], expect[data[0]]++);
+        offset = table.next(offset);
+    }
+
+    for (auto &writer : writers)
+        writer.join();
+
+    ASSERT_EQ(table.size(), offset);
+    ASSERT_EQ(table.index(), 251);
+    ASSERT_EQ(table.seek(4000), offset);
+
+    remove_table();
+}
+
+TEST(framed_table, segment)
+{
+    air::lightmdb::options opts;
+    opts.segment = 64;
+    ASSERT_THROW(framed::table<>(FILE_NAME, air::lightmdb::mode_t::create_only, 64, opts), std::runtime_error);
+    remove_table();
+}
+
+TEST(framed_table, discard)
+{
+    framed::table<true, 100> table(FILE_NAME, air::lightmdb::mode_t::create_only, 64);
+    std::string data(100, 'x');
+    for (size_t i = 0; i < 10000; i++)
+        table.push(data.data(), data.size());
+
+    // 只释放到稀疏索引的最后一项之前 (这里为 10000 条全部提交后的末尾), 帧偏移与 seek 不变
+    auto offset = table.seek(8000);
+    ASSERT_TRUE(table.discard_before(offset));
+    ASSERT_EQ(table.discarded(), offset);
+    ASSERT_TRUE(table.discard_before(table.size()));
+    ASSERT_EQ(table.discarded(), table.size());
+    table.push(data.data(), data.size());
+
+    ASSERT_EQ(table.seek(8000), offset);
+    ASSERT_EQ(table.seek(10000), table.discarded());
+    for (auto i = table.seek(10000); i < table.size(); i = table.next(i))
+    {
+        auto val = table[i];
+        ASSERT_EQ(std::string(static_cast<const char *>(val.first), val.second), data);
+    }
+
+    remove_table();
+}
+
+TEST(framed_table, recover)
+{
+    using table_type = framed::table<true, 4>;
+    std::string data(10, 'x');
+    size_t stranded;
+    {
+        table_type table(FILE_NAME, air::lightmdb::mode_t::create_only, 64);
+        for (size_t i = 0; i < 10; i++)
+            table.push(data.data(), data.size());
+
+        // 模拟写入者崩溃: 一帧写入了帧长但未提交, 一帧 (16 字节数据, 共 24 字节) 占用后连帧长都没有写入
+        stranded = table.reserve(16).offset;
+        detail::mmap view(FILE_NAME, air::lightmdb::mode_t::read_write);
+        view.get_header().size.fetch_add(24);
+        for (size_t i = 0; i < 10; i++)
+            table.push(data.data(), data.size());
+        ASSERT_EQ(table.committed(), stranded);
+
+        // 构建稀疏索引时崩溃留下的锁使 index 不再推进
+        detail::mmap index(std::string(FILE_NAME) + "x", air::lightmdb::mode_t::read_write);
+        index.get_header().lock = true;
+        ASSERT_EQ(table.index(), 3);
+    }
+
+    air::lightmdb::options opts;
+    opts.recover = true;
+    table_type table(FILE_NAME, air::lightmdb::mode_t::read_write, opts);
+    ASSERT_EQ(table.committed(), table.size());
+    ASSERT_EQ(table.recover(), 0);
+
+    // 未写帧长的 24 字节按 3 个空帧跳过, 之后对齐到下一帧
+    ASSERT_TRUE(table.skipped(stranded));
+    size_t frames = 0, skipped = 0;
+    for (size_t offset = 0; offset < table.size(); offset = table.next(offset), frames++)
+    {
+        if (table.skipped(offset))
+        {
+            skipped++;
+            continue;
+        }
+        auto val = table[offset];
+        ASSERT_EQ(std::string(static_cast<const char *>(val.first), val.second), data);
+    }
+    ASSERT_EQ(frames, 24);
+    ASSERT_EQ(skipped, 4);
+    ASSERT_EQ(table.index(), 7);
+
+    remove_table();
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,62 @@
+#include <thread>
+#include <filesystem>
+#include <array>
+
+#include <benchmark/benchmark.h>
+
+#include "air/lightmdb/framed.hpp"
+
+using namespace air::lightmdb;
+constexpr auto FILE_NAME = "table.db";
+static auto THREADS = 32 > std::thread::hardware_concurrency() ? 32 : std::thread::hardware_concurrency();
+
+static void DoSetup(const benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    framed::table table(file, air::lightmdb::mode_t::create_only, 1024);
+}
+
+static void DoTeardown(const benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    std::filesystem::remove(file);
+    std::filesystem::remove(file + "x");
+}
+
+template <size_t I>
+static void framed_table(benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    framed::table table(file, air::lightmdb::mode_t::read_write);
+    std::array<char, I> i;
+    for (auto _ : state)
+    {
+        table.push(&i, sizeof(i));
+        i[0]++;
+    }
+}
+BENCHMARK(framed_table<8>)->ThreadRange(1, THREADS)->Setup(DoSetup)->Teardown(DoTeardown);
+BENCHMARK(framed_table<16>)->ThreadRange(1, THREADS)->Setup(DoSetup)->Teardown(DoTeardown);
+BENCHMARK(framed_table<32>)->ThreadRange(1, THREADS)->Setup(DoSetup)->Teardown(DoTeardown);
+BENCHMARK(framed_table<64>)->ThreadRange(1, THREADS)->Setup(DoSetup)->Teardown(DoTeardown);
+
+static void framed_table_scan(benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    framed::table table(file, air::lightmdb::mode_t::read_write);
+    std::array<char, 32> val{};
+    for (int i = 0; i < 1 << 16; ++i)
+        table.push(&val, sizeof(val));
+
+    for (auto _ : state)
+    {
+        std::size_t bytes = 0;
+        for (std::size_t offset = 0; offset < table.size(); offset = table.next(offset))
+            bytes += table[offset].second;
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.SetItemsProcessed(state.iterations() * (1 << 16));
+}
+BENCHMARK(framed_table_scan)->Setup(DoSetup)->Teardown(DoTeardown);
+
+BENCHMARK_MAIN();
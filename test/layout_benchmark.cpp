@@ -0,0 +1,88 @@
+#include <thread>
+#include <filesystem>
+#include <array>
+
+#include <benchmark/benchmark.h>
+
+#include "air/lightmdb/fixed.hpp"
+#include "air/lightmdb/cursor.hpp"
+
+using namespace air::lightmdb;
+constexpr auto FILE_NAME = "layout.db";
+constexpr size_t SCAN_SIZE = 1 << 20;
+
+template <size_t I, typename Layout>
+using table_type = fixed::table<std::array<char, I>, true, Layout>;
+
+template <size_t I, typename Layout>
+static void DoSetup(const benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    table_type<I, Layout> table(file, air::lightmdb::mode_t::create_only, 1024);
+}
+
+static void DoTeardown(const benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    std::filesystem::remove(file);
+}
+
+template <size_t I, typename Layout>
+static void layout_push(benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    table_type<I, Layout> table(file, air::lightmdb::mode_t::read_write);
+    std::array<char, I> i{};
+    for (auto _ : state)
+    {
+        table.push(i);
+        i[0] += 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/// 游标顺序扫描已写满的 table
+template <size_t I, typename Layout>
+static void layout_scan(benchmark::State &state)
+{
+    table_type<I, Layout> table(FILE_NAME, air::lightmdb::mode_t::create_only, SCAN_SIZE);
+    std::array<char, I> i{};
+    for (size_t n = 0; n < SCAN_SIZE; n++)
+        table.push(i);
+
+    for (auto _ : state)
+    {
+        cursor<table_type<I, Layout>, wait::busy_spin> reader(table);
+        size_t sum = 0;
+        while (reader.poll(SCAN_SIZE, [&](const std::array<char, I> &val)
+                           { sum += val[0]; }) != 0)
+            ;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * SCAN_SIZE);
+    state.SetBytesProcessed(state.iterations() * SCAN_SIZE * I);
+    std::filesystem::remove(FILE_NAME);
+}
+
+#define LAYOUT_BENCHMARK(I, Layout)                                                                                                      \
+    BENCHMARK(layout_push<I, layout::Layout>)->Threads(1)->Threads(4)->MinTime(0.2)->Setup(DoSetup<I, layout::Layout>)->Teardown(DoTeardown); \
+    BENCHMARK(layout_scan<I, layout::Layout>)->MinTime(0.2);
+
+LAYOUT_BENCHMARK(8, packed)
+LAYOUT_BENCHMARK(8, aligned)
+LAYOUT_BENCHMARK(8, sequence)
+LAYOUT_BENCHMARK(8, bitmap)
+LAYOUT_BENCHMARK(16, packed)
+LAYOUT_BENCHMARK(16, aligned)
+LAYOUT_BENCHMARK(16, sequence)
+LAYOUT_BENCHMARK(16, bitmap)
+LAYOUT_BENCHMARK(32, packed)
+LAYOUT_BENCHMARK(32, aligned)
+LAYOUT_BENCHMARK(32, sequence)
+LAYOUT_BENCHMARK(32, bitmap)
+LAYOUT_BENCHMARK(64, packed)
+LAYOUT_BENCHMARK(64, aligned)
+LAYOUT_BENCHMARK(64, sequence)
+LAYOUT_BENCHMARK(64, bitmap)
+
+BENCHMARK_MAIN();
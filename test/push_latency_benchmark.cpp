@@ -0,0 +1,83 @@
+#include <filesystem>
+#include <array>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include <benchmark/benchmark.h>
+
+#include "air/lightmdb/fixed.hpp"
+
+using namespace air::lightmdb;
+constexpr auto FILE_NAME = "latency.db";
+
+enum option_set : int64_t
+{
+    none = 0,
+    prefault,
+    huge_pages,
+    sequential,
+    /// 后台刷盘线程不应影响 push 延迟
+    group_commit,
+    /// 后台线程在 75% 处提前扩容, push 不再等待文件扩展
+    growth,
+    all
+};
+
+static options make_options(int64_t set)
+{
+    options opts;
+    if (set == prefault || set == all)
+        opts.prefault = 8 << 20;
+    if (set == huge_pages || set == all)
+        opts.huge_pages = true;
+    if (set == sequential || set == all)
+        opts.advice = advice_t::sequential;
+    if (set == group_commit || set == all)
+        opts.durability = durability_t::group_commit;
+    if (set == growth || set == all)
+        opts.growth_threshold = 0.75;
+    return opts;
+}
+
+/// 逐条记录 push 耗时, 以 p50/p99/p999/max (ns) 计数器输出
+template <size_t I>
+static void push_latency(benchmark::State &state)
+{
+    auto opts = make_options(state.range(0));
+    std::vector<int64_t> latency;
+    latency.reserve(1 << 20);
+
+    {
+        fixed::table<std::array<char, I>> table(FILE_NAME, air::lightmdb::mode_t::create_only, 1024, opts);
+        std::array<char, I> i{};
+        for (auto _ : state)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            benchmark::DoNotOptimize(table.push(i));
+            auto end = std::chrono::steady_clock::now();
+
+            if (latency.size() < latency.capacity())
+                latency.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+            i[0] += 1;
+        }
+    }
+    std::filesystem::remove(FILE_NAME);
+
+    if (latency.empty())
+        return;
+
+    std::sort(latency.begin(), latency.end());
+    auto percentile = [&](double p)
+    {
+        return double(latency[std::min(latency.size() - 1, size_t(p * latency.size()))]);
+    };
+    state.counters["p50"] = percentile(0.5);
+    state.counters["p99"] = percentile(0.99);
+    state.counters["p999"] = percentile(0.999);
+    state.counters["max"] = double(latency.back());
+}
+BENCHMARK(push_latency<8>)->ArgName("options")->DenseRange(none, all);
+BENCHMARK(push_latency<64>)->ArgName("options")->DenseRange(none, all);
+
+BENCHMARK_MAIN();
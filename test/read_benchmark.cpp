@@ -0,0 +1,242 @@
+#include <filesystem>
+#include <thread>
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <cstddef>
+
+#include <benchmark/benchmark.h>
+
+#include "air/lightmdb/fixed.hpp"
+#include "air/lightmdb/variable.hpp"
+#include "air/lightmdb/cursor.hpp"
+
+using namespace air::lightmdb;
+constexpr auto FIXED_NAME = "read_fixed.db";
+constexpr auto VARIABLE_NAME = "read_variable.db";
+constexpr auto RACE_NAME = "read_race.db";
+/// 顺序扫描与随机读取的数据条数
+constexpr std::size_t RECORDS = 10'000'000;
+/// 随机读取的下标个数
+constexpr std::size_t LOOKUPS = 1 << 20;
+/// 与写入者竞争时读取的数据条数, 从 1024 开始扩容约 10 次
+constexpr std::size_t RACE_RECORDS = 1 << 20;
+
+/// 参数 0/1/2 分别对应 read_only/read_private/copy_on_write
+static air::lightmdb::mode_t read_mode(int64_t arg)
+{
+    switch (arg)
+    {
+    case 1:
+        return air::lightmdb::mode_t::read_private;
+    case 2:
+        return air::lightmdb::mode_t::copy_on_write;
+    default:
+        return air::lightmdb::mode_t::read_only;
+    }
+}
+
+static std::vector<std::size_t> random_indexes()
+{
+    std::mt19937_64 engine(42);
+    std::uniform_int_distribution<std::size_t> dist(0, RECORDS - 1);
+    std::vector<std::size_t> indexes(LOOKUPS);
+    for (auto &index : indexes)
+        index = dist(engine);
+    return indexes;
+}
+
+static void FixedSetup(const benchmark::State &)
+{
+    fixed::table<std::uint64_t> table(FIXED_NAME, air::lightmdb::mode_t::create_only, RECORDS);
+    for (std::uint64_t i = 0; i < RECORDS; ++i)
+        table.push(i);
+}
+
+static void FixedTeardown(const benchmark::State &)
+{
+    std::filesystem::remove(FIXED_NAME);
+}
+
+static void VariableSetup(const benchmark::State &)
+{
+    variable::table table(VARIABLE_NAME, air::lightmdb::mode_t::create_only, RECORDS * sizeof(std::uint64_t), RECORDS);
+    for (std::uint64_t i = 0; i < RECORDS; ++i)
+        table.push(&i, sizeof(i));
+}
+
+static void VariableTeardown(const benchmark::State &)
+{
+    std::filesystem::remove(VARIABLE_NAME);
+    std::filesystem::remove(std::string(VARIABLE_NAME) + "i");
+}
+
+static void fixed_scan(benchmark::State &state)
+{
+    fixed::table<std::uint64_t> table(FIXED_NAME, read_mode(state.range(0)));
+    for (auto _ : state)
+    {
+        std::uint64_t sum = 0;
+        for (std::size_t i = 0; i < RECORDS; ++i)
+            sum += table[i];
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * RECORDS);
+    state.SetBytesProcessed(state.iterations() * RECORDS * sizeof(std::uint64_t));
+}
+BENCHMARK(fixed_scan)->ArgName("mode")->DenseRange(0, 2)->Unit(benchmark::kMillisecond)->Setup(FixedSetup)->Teardown(FixedTeardown);
+
+/// 每条数据先检查 has_value 再读取, 与读者追赶写入者时的路径相同
+static void fixed_scan_has_value(benchmark::State &state)
+{
+    fixed::table<std::uint64_t> table(FIXED_NAME, air::lightmdb::mode_t::read_only);
+    for (auto _ : state)
+    {
+        std::uint64_t sum = 0;
+        for (std::size_t i = 0; i < RECORDS; ++i)
+        {
+            if (table.has_value(i))
+                sum += table[i];
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * RECORDS);
+    state.SetBytesProcessed(state.iterations() * RECORDS * sizeof(std::uint64_t));
+}
+BENCHMARK(fixed_scan_has_value)->Unit(benchmark::kMillisecond)->Setup(FixedSetup)->Teardown(FixedTeardown);
+
+static void fixed_scan_cursor(benchmark::State &state)
+{
+    fixed::table<std::uint64_t> table(FIXED_NAME, air::lightmdb::mode_t::read_only);
+    for (auto _ : state)
+    {
+        cursor<fixed::table<std::uint64_t>> reader(table);
+        std::uint64_t sum = 0;
+        while (reader.position() < RECORDS)
+        {
+            reader.poll(RECORDS, [&](std::uint64_t val)
+                        { sum += val; });
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * RECORDS);
+    state.SetBytesProcessed(state.iterations() * RECORDS * sizeof(std::uint64_t));
+}
+BENCHMARK(fixed_scan_cursor)->Unit(benchmark::kMillisecond)->Setup(FixedSetup)->Teardown(FixedTeardown);
+
+static void fixed_random(benchmark::State &state)
+{
+    fixed::table<std::uint64_t> table(FIXED_NAME, read_mode(state.range(0)));
+    auto indexes = random_indexes();
+    for (auto _ : state)
+    {
+        std::uint64_t sum = 0;
+        for (auto index : indexes)
+            sum += table[index];
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * LOOKUPS);
+    state.SetBytesProcessed(state.iterations() * LOOKUPS * sizeof(std::uint64_t));
+}
+BENCHMARK(fixed_random)->ArgName("mode")->DenseRange(0, 2)->Unit(benchmark::kMillisecond)->Setup(FixedSetup)->Teardown(FixedTeardown);
+
+static void variable_scan(benchmark::State &state)
+{
+    variable::table table(VARIABLE_NAME, read_mode(state.range(0)));
+    for (auto _ : state)
+    {
+        std::uint64_t sum = 0;
+        for (std::size_t i = 0; i < RECORDS; ++i)
+            sum += *static_cast<const std::uint64_t *>(table[i].first);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * RECORDS);
+    state.SetBytesProcessed(state.iterations() * RECORDS * sizeof(std::uint64_t));
+}
+BENCHMARK(variable_scan)->ArgName("mode")->DenseRange(0, 2)->Unit(benchmark::kMillisecond)->Setup(VariableSetup)->Teardown(VariableTeardown);
+
+static void variable_random(benchmark::State &state)
+{
+    variable::table table(VARIABLE_NAME, read_mode(state.range(0)));
+    auto indexes = random_indexes();
+    for (auto _ : state)
+    {
+        std::uint64_t sum = 0;
+        for (auto index : indexes)
+            sum += *static_cast<const std::uint64_t *>(table[index].first);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * LOOKUPS);
+    state.SetBytesProcessed(state.iterations() * LOOKUPS * sizeof(std::uint64_t));
+}
+BENCHMARK(variable_random)->ArgName("mode")->DenseRange(0, 2)->Unit(benchmark::kMillisecond)->Setup(VariableSetup)->Teardown(VariableTeardown);
+
+/// 读者用 wait 追赶一个从 1024 条开始反复扩容的写入者, 覆盖 do_read 中等待 capacity 与 remmap 的路径
+static void fixed_race(benchmark::State &state)
+{
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        fixed::table<std::uint64_t>(RACE_NAME, air::lightmdb::mode_t::create_only, 1024);
+        state.ResumeTiming();
+
+        std::thread writer([]()
+                           {
+            fixed::table<std::uint64_t> table(RACE_NAME, air::lightmdb::mode_t::read_write);
+            for (std::uint64_t i = 0; i < RACE_RECORDS; ++i)
+                table.push(i); });
+
+        fixed::table<std::uint64_t> table(RACE_NAME, air::lightmdb::mode_t::read_only);
+        std::uint64_t sum = 0;
+        for (std::size_t i = 0; i < RACE_RECORDS; ++i)
+        {
+            table.wait(i);
+            sum += table[i];
+        }
+        benchmark::DoNotOptimize(sum);
+        writer.join();
+
+        state.PauseTiming();
+        std::filesystem::remove(RACE_NAME);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * RACE_RECORDS);
+    state.SetBytesProcessed(state.iterations() * RACE_RECORDS * sizeof(std::uint64_t));
+}
+BENCHMARK(fixed_race)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void variable_race(benchmark::State &state)
+{
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        variable::table(RACE_NAME, air::lightmdb::mode_t::create_only, 1024, 1024);
+        state.ResumeTiming();
+
+        std::thread writer([]()
+                           {
+            variable::table table(RACE_NAME, air::lightmdb::mode_t::read_write);
+            for (std::uint64_t i = 0; i < RACE_RECORDS; ++i)
+                table.push(&i, sizeof(i)); });
+
+        variable::table table(RACE_NAME, air::lightmdb::mode_t::read_only);
+        std::uint64_t sum = 0;
+        for (std::size_t i = 0; i < RACE_RECORDS; ++i)
+        {
+            table.wait(i);
+            sum += *static_cast<const std::uint64_t *>(table[i].first);
+        }
+        benchmark::DoNotOptimize(sum);
+        writer.join();
+
+        state.PauseTiming();
+        std::filesystem::remove(RACE_NAME);
+        std::filesystem::remove(std::string(RACE_NAME) + "i");
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * RACE_RECORDS);
+    state.SetBytesProcessed(state.iterations() * RACE_RECORDS * sizeof(std::uint64_t));
+}
+BENCHMARK(variable_race)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
\ No newline at end of file
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "air/lightmdb/ring.hpp"
+
+using namespace air::lightmdb;
+constexpr auto FILE_NAME = "ring.db";
+
+TEST(ring_table, lap)
+{
+    ring::table<size_t> table(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+    ASSERT_EQ(table.capacity(), 8);
+    ASSERT_TRUE(table.empty());
+    auto file_size = std::filesystem::file_size(FILE_NAME);
+
+    ring::reader<ring::table<size_t>> reader(table);
+    size_t val = 0;
+    ASSERT_EQ(reader.next(val), ring::status_t::pending);
+
+    for (size_t i = 0; i < 5; i++)
+        ASSERT_EQ(table.push(i), i);
+    for (size_t i = 0; i < 5; i++)
+    {
+        ASSERT_EQ(reader.next(val), ring::status_t::ok);
+        ASSERT_EQ(val, i);
+    }
+
+    // 写入 20 条后序号 5 所在的位置已被 21 覆盖, 读者跳到最旧的 17
+    for (size_t i = 5; i < 25; i++)
+        table.push(i);
+    ASSERT_EQ(table.oldest(), 17);
+    ASSERT_EQ(reader.next(val), ring::status_t::lapped);
+    ASSERT_EQ(reader.position(), 17);
+    ASSERT_EQ(reader.lost(), 12);
+
+    for (size_t i = 17; i < 25; i++)
+    {
+        ASSERT_EQ(reader.next(val), ring::status_t::ok);
+        ASSERT_EQ(val, i);
+    }
+    ASSERT_EQ(reader.next(val), ring::status_t::pending);
+
+    // 容量固定, 文件不会增长
+    ASSERT_EQ(std::filesystem::file_size(FILE_NAME), file_size);
+
+    ring::table<size_t> other(FILE_NAME, air::lightmdb::mode_t::read_only);
+    ASSERT_EQ(other.capacity(), 8);
+    ASSERT_EQ(other.size(), 25);
+    ASSERT_EQ(other.read(24, val), ring::status_t::ok);
+    ASSERT_EQ(val, 24);
+
+    std::filesystem::remove(FILE_NAME);
+}
+
+TEST(ring_table, capacity)
+{
+    ASSERT_THROW(ring::table<size_t>(FILE_NAME, air::lightmdb::mode_t::create_only, 6), std::runtime_error);
+    std::filesystem::remove(FILE_NAME);
+
+    // 已有的环不能以其他容量打开, 否则各进程取模不一致
+    ring::table<size_t> table(FILE_NAME, air::lightmdb::mode_t::open_or_create, 8);
+    ASSERT_THROW(ring::table<size_t>(FILE_NAME, air::lightmdb::mode_t::open_or_create, 16), std::runtime_error);
+    ASSERT_THROW(ring::table<size_t>(FILE_NAME, air::lightmdb::mode_t::open_or_create, 4), std::runtime_error);
+    ASSERT_EQ(ring::table<size_t>(FILE_NAME, air::lightmdb::mode_t::open_or_create, 8).capacity(), 8);
+    ASSERT_EQ(table.capacity(), 8);
+    std::filesystem::remove(FILE_NAME);
+}
+
+struct message
+{
+    size_t writer;
+    size_t sequence;
+    size_t check;
+};
+
+TEST(ring_table, concurrent)
+{
+    using table_type = ring::table<message>;
+    table_type(FILE_NAME, air::lightmdb::mode_t::create_only, 64);
+
+    constexpr size_t WRITERS = 4;
+    constexpr size_t RECORDS = 20000;
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < WRITERS; t++)
+    {
+        writers.emplace_back([t]()
+                             {
+            table_type table(FILE_NAME, air::lightmdb::mode_t::read_write);
+            for (size_t i = 0; i < RECORDS; i++)
+                table.push({t, i, t * 1000003 + i}); });
+    }
+
+    // 慢读者会被套圈, 但读到的数据不能是写了一半的
+    table_type table(FILE_NAME, air::lightmdb::mode_t::read_only);
+    ring::reader<table_type> reader(table);
+    std::vector<size_t> last(WRITERS, 0);
+    size_t read = 0;
+    while (reader.position() < WRITERS * RECORDS)
+    {
+        message val;
+        reader.wait_next(val);
+        ASSERT_EQ(val.check, val.writer * 1000003 + val.sequence);
+        ASSERT_GE(val.sequence + 1, last[val.writer]);
+        last[val.writer] = val.sequence + 1;
+        ++read;
+    }
+
+    for (auto &writer : writers)
+        writer.join();
+    ASSERT_EQ(read + reader.lost(), WRITERS * RECORDS);
+
+    std::filesystem::remove(FILE_NAME);
+}
+
+TEST(ring_table, wait)
+{
+    using table_type = ring::table<size_t>;
+    table_type writer(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+
+    // 只读的读者登记为等待者后阻塞, 由写入者唤醒
+    table_type table(FILE_NAME, air::lightmdb::mode_t::read_only);
+    detail::mmap view(FILE_NAME, air::lightmdb::mode_t::read_only);
+    std::thread reader([&]()
+                       { table.wait(0); });
+    // 没有原生 futex 时读者轮询, 不登记 waiters
+    while (detail::atomic<std::uint32_t>::always_has_native_wait_notify && view.get_header().waiters.load() == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    writer.push(42);
+    reader.join();
+    ASSERT_EQ(view.get_header().waiters, 0);
+    ASSERT_TRUE(table.has_value(0));
+
+    std::filesystem::remove(FILE_NAME);
+}
+
+TEST(ring_table, variable)
+{
+    ASSERT_THROW(ring::variable_table(FILE_NAME, air::lightmdb::mode_t::create_only, 100, 16), std::runtime_error);
+    std::filesystem::remove(std::string(FILE_NAME) + "i");
+
+    ring::variable_table table(FILE_NAME, air::lightmdb::mode_t::create_only, 128, 16);
+    ring::reader<ring::variable_table> reader(table);
+    std::vector<char> val;
+
+    // 长度 1..20 的数据按 8 字节对齐占用 8/16/24 字节, 数据环在 128 字节处绕回
+    std::string data(20, 'x');
+    for (size_t i = 0; i < 10; i++)
+    {
+        data.assign(i + 1, static_cast<char>('a' + i));
+        ASSERT_EQ(table.push(data.data(), data.size()), i);
+    }
+
+    // 前 10 条共占用 96 字节, 都还在环中
+    for (size_t i = 0; i < 10; i++)
+    {
+        ASSERT_EQ(reader.next(val), ring::status_t::ok);
+        ASSERT_EQ(std::string(val.begin(), val.end()), std::string(i + 1, static_cast<char>('a' + i)));
+    }
+
+    for (size_t i = 10; i < 20; i++)
+    {
+        data.assign(i + 1, static_cast<char>('a' + i));
+        table.push(data.data(), data.size());
+    }
+    ASSERT_EQ(table.size().second, 288);
+
+    // 索引环中最旧的是 4, 但数据环只保留最后 128 字节, 从偏移 160 的第 14 条开始的数据完整
+    ring::reader<ring::variable_table> late(table, 4);
+    size_t read = 0;
+    while (late.position() < 20)
+    {
+        if (late.next(val) != ring::status_t::ok)
+            continue;
+        auto i = late.position() - 1;
+        ASSERT_EQ(std::string(val.begin(), val.end()), std::string(i + 1, static_cast<char>('a' + i)));
+        ++read;
+    }
+    ASSERT_EQ(read, 6);
+    ASSERT_EQ(late.lost(), 10);
+
+    ASSERT_THROW(table.push(data.data(), 129), std::runtime_error);
+
+    std::filesystem::remove(FILE_NAME);
+    std::filesystem::remove(std::string(FILE_NAME) + "i");
+}
+
+TEST(ring_table, variable_concurrent)
+{
+    // 数据环只有 256 字节, 写入者频繁互相套圈; 读到 ok 的数据不能被慢写入者改写
+    // 写入者不按占用顺序提交, 水位仍然推进到所有数据之后
+    ring::variable_table(FILE_NAME, air::lightmdb::mode_t::create_only, 256, 16);
+
+    constexpr size_t WRITERS = 4;
+    constexpr size_t RECORDS = 20000;
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < WRITERS; t++)
+    {
+        writers.emplace_back([t]()
+                             {
+            ring::variable_table table(FILE_NAME, air::lightmdb::mode_t::read_write);
+            for (size_t i = 0; i < RECORDS; i++)
+            {
+                std::string data(1 + (t + i) % 31, static_cast<char>('a' + t));
+                table.push(data.data(), data.size());
+            } });
+    }
+
+    ring::variable_table table(FILE_NAME, air::lightmdb::mode_t::read_only);
+    ring::reader<ring::variable_table> reader(table);
+    std::vector<char> val;
+    while (reader.position() < WRITERS * RECORDS)
+    {
+        reader.wait_next(val);
+        ASSERT_FALSE(val.empty());
+        ASSERT_EQ(std::count(val.begin(), val.end(), val.front()), val.size());
+    }
+
+    size_t bytes = 0;
+    for (size_t t = 0; t < WRITERS; t++)
+    {
+        writers[t].join();
+        for (size_t i = 0; i < RECORDS; i++)
+            bytes += (1 + (t + i) % 31 + 7) / 8 * 8;
+    }
+    ASSERT_EQ(table.size().second, bytes);
+    detail::mmap view(FILE_NAME, air::lightmdb::mode_t::read_only);
+    ASSERT_EQ(view.get_header().committed, bytes);
+
+    std::filesystem::remove(FILE_NAME);
+    std::filesystem::remove(std::string(FILE_NAME) + "i");
+}
+
+TEST(ring_table, variable_stalled)
+{
+    ring::variable_table table(FILE_NAME, air::lightmdb::mode_t::create_only, 256, 16);
+    detail::mmap view(FILE_NAME, air::lightmdb::mode_t::read_write);
+
+    // 模拟占用了 [0, 8) 后被调度出去的写入者: 之后的写入者不等待它, 但水位停在它之前
+    view.get_header().size.fetch_add(8);
+    std::string data(16, 'x');
+    ASSERT_EQ(table.push(data.data(), data.size()), 0);
+    ASSERT_EQ(table.push(data.data(), data.size()), 1);
+    ASSERT_EQ(table.size().second, 40);
+    ASSERT_EQ(view.get_header().committed, 0);
+
+    std::vector<char> val;
+    ASSERT_EQ(table.read(1, val), ring::status_t::ok);
+    ASSERT_EQ(std::string(val.begin(), val.end()), data);
+
+    std::filesystem::remove(FILE_NAME);
+    std::filesystem::remove(std::string(FILE_NAME) + "i");
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
\ No newline at end of file
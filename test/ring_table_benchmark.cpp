@@ -0,0 +1,59 @@
+#include <thread>
+#include <filesystem>
+#include <array>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "air/lightmdb/ring.hpp"
+
+using namespace air::lightmdb;
+constexpr auto FILE_NAME = "ring.db";
+static auto THREADS = 32 > std::thread::hardware_concurrency() ? 32 : std::thread::hardware_concurrency();
+
+static void DoSetup(const benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    ring::table<std::array<char, 64>>(file, air::lightmdb::mode_t::create_only, 1 << 12);
+    ring::variable_table(file + "v", air::lightmdb::mode_t::create_only, 1 << 16, 1 << 12);
+}
+
+static void DoTeardown(const benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    std::filesystem::remove(file);
+    std::filesystem::remove(file + "v");
+    std::filesystem::remove(file + "vi");
+}
+
+static void ring_table(benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    ring::table<std::array<char, 64>> table(file, air::lightmdb::mode_t::read_write);
+    std::array<char, 64> i{};
+    for (auto _ : state)
+    {
+        table.push(i);
+        i[0] += 1;
+    }
+}
+BENCHMARK(ring_table)->ThreadRange(1, THREADS)->Setup(DoSetup)->Teardown(DoTeardown);
+
+// 多个写入者同时写入数据环, 一个写入者被调度出去时不应阻塞其他写入者发布
+template <size_t I>
+static void ring_variable_table(benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME + "v";
+    ring::variable_table table(file, air::lightmdb::mode_t::read_write);
+    std::array<char, I> i{};
+    for (auto _ : state)
+    {
+        table.push(i.data(), i.size());
+        i[0] += 1;
+    }
+    state.SetBytesProcessed(state.iterations() * I);
+}
+BENCHMARK(ring_variable_table<16>)->ThreadRange(1, THREADS)->Setup(DoSetup)->Teardown(DoTeardown);
+BENCHMARK(ring_variable_table<256>)->ThreadRange(1, THREADS)->Setup(DoSetup)->Teardown(DoTeardown);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,156 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "air/lightmdb/fixed.hpp"
+#include "air/lightmdb/variable.hpp"
+#include "air/lightmdb/sparse.hpp"
+
+using namespace air::lightmdb;
+constexpr auto FILE_NAME = "sparse.db";
+
+struct tick
+{
+    std::uint64_t time;
+    std::uint64_t value;
+};
+
+struct tick_time
+{
+    std::uint64_t operator()(const tick &val) const
+    {
+        return val.time;
+    }
+};
+
+/// 暴力查找第一条键不小于 key 的非跳过数据
+template <typename Table, typename Extract>
+static size_t expect_lower_bound(Table &table, Extract extract, std::uint64_t key)
+{
+    size_t i = 0;
+    for (; i < table.committed(); i++)
+    {
+        if (!table.skipped(i) && !(extract(table[i]) < key))
+            break;
+    }
+    return i;
+}
+
+TEST(sparse, fixed_table)
+{
+    using table_type = fixed::table<tick>;
+    using index_type = sparse::key_index<table_type, tick_time, 64>;
+    table_type table(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+    index_type index(table, FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+
+    // 每个时间戳重复 3 次
+    for (std::uint64_t i = 0; i < 100000; i++)
+        table.push({i / 3 * 10 + 100, i});
+    ASSERT_EQ(index.lower_bound(0), 0);
+    ASSERT_EQ(index.size(), 100000 / 64 + 1);
+
+    for (std::uint64_t key : {99, 100, 101, 110, 115, 5000, 5005, 333330, 333420, 333430, 1000000})
+        ASSERT_EQ(index.lower_bound(key), expect_lower_bound(table, tick_time{}, key)) << key;
+    ASSERT_EQ(index.lower_bound(5000), 4900 / 10 * 3);
+    ASSERT_EQ(index.lower_bound(1000000), 100000);
+
+    // 只读的索引不更新, 之后的数据在最后一项之后二分查找
+    for (std::uint64_t i = 100000; i < 100100; i++)
+        table.push({i / 3 * 10 + 100, i});
+    table_type reader(FILE_NAME, air::lightmdb::mode_t::read_only);
+    index_type other(reader, FILE_NAME, air::lightmdb::mode_t::read_only);
+    ASSERT_EQ(other.size(), 100000 / 64 + 1);
+    ASSERT_EQ(other.lower_bound(333440), expect_lower_bound(table, tick_time{}, 333440));
+    ASSERT_EQ(other.lower_bound(333440), 100002);
+    ASSERT_EQ(other.size(), 100000 / 64 + 1);
+
+    // 通过索引写入时每写满一段更新一次, 只读的索引随之扩展
+    for (std::uint64_t i = 100100; i < 100160; i++)
+        index.push(tick{i / 3 * 10 + 100, i});
+    ASSERT_EQ(other.size(), 100160 / 64);
+
+    {
+        // 构建中崩溃留下的锁使 update 直接返回, 由 options::recover 清除
+        detail::mmap view(std::string(FILE_NAME) + "k", air::lightmdb::mode_t::read_write);
+        view.get_header().lock = true;
+    }
+    for (std::uint64_t i = 100160; i < 100200; i++)
+        table.push({i / 3 * 10 + 100, i});
+    ASSERT_EQ(index.update(), 100160 / 64);
+
+    air::lightmdb::options opts;
+    opts.recover = true;
+    index_type recovered(table, FILE_NAME, air::lightmdb::mode_t::read_write, tick_time{}, opts);
+    ASSERT_EQ(recovered.update(), 100200 / 64 + 1);
+    ASSERT_EQ(recovered.lower_bound(333440), 100002);
+
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "k");
+}
+
+TEST(sparse, skipped)
+{
+    using table_type = fixed::table<tick>;
+    using index_type = sparse::key_index<table_type, tick_time, 4>;
+    table_type table(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+    index_type index(table, FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+
+    // 每 16 个位置只写入 5 条, 其余为跳过标记, 有的索引段整段都被跳过
+    std::uint64_t time = 0;
+    for (size_t c = 0; c < 50; c++)
+    {
+        table_type::chunk chunk(table, 16);
+        for (size_t i = 0; i < 5; i++)
+            chunk.push({time++ / 2, 0});
+    }
+    ASSERT_EQ(table.committed(), 800);
+
+    for (std::uint64_t key = 0; key <= time / 2 + 1; key++)
+        ASSERT_EQ(index.lower_bound(key), expect_lower_bound(table, tick_time{}, key)) << key;
+
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "k");
+}
+
+struct record_time
+{
+    std::uint64_t operator()(std::pair<const void *, size_t> val) const
+    {
+        std::uint64_t time;
+        memcpy(&time, val.first, sizeof(time));
+        return time;
+    }
+};
+
+TEST(sparse, variable_table)
+{
+    using table_type = variable::table<>;
+    table_type table(FILE_NAME, air::lightmdb::mode_t::create_only, 64, 8);
+    sparse::key_index<table_type, record_time, 16> index(table, FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+
+    // 时间戳之后附带长度不等的数据
+    std::string data(64, 'x');
+    for (std::uint64_t i = 0; i < 5000; i++)
+    {
+        auto size = sizeof(i) + i % 50;
+        memcpy(data.data(), &i, sizeof(i));
+        table.push(data.data(), size);
+    }
+
+    for (std::uint64_t key : {0, 1, 17, 2500, 4999, 5000})
+        ASSERT_EQ(index.lower_bound(key), key);
+
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "i");
+    air::lightmdb::remove(std::string(FILE_NAME) + "k");
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
\ No newline at end of file
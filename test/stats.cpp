@@ -0,0 +1,144 @@
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+
+#include <gtest/gtest.h>
+#include "air/lightmdb/fixed.hpp"
+#include "air/lightmdb/variable.hpp"
+
+using namespace air::lightmdb;
+constexpr auto FILE_NAME = "stats.db";
+
+static_assert(detail::stats_enabled, "stats test must be built with AIR_LIGHTMDB_STATS");
+
+TEST(stats, fixed_table)
+{
+    {
+        fixed::table<size_t> table(FILE_NAME, air::lightmdb::mode_t::create_only, 8);
+        for (size_t i = 0; i < 100; i++)
+            table.push(i);
+
+        std::vector<size_t> values(28);
+        table.push(values.begin(), values.end());
+    }
+
+    detail::mmap map(FILE_NAME, air::lightmdb::mode_t::read_only);
+    auto &stats = map.get_header().stats;
+    ASSERT_EQ(stats.pushes, 128);
+    ASSERT_EQ(stats.bytes, 128 * sizeof(size_t));
+    // 8 -> 16 -> 32 -> 64 -> 128
+    ASSERT_EQ(stats.recapacity, 4);
+    ASSERT_EQ(stats.remmap, 4);
+    ASSERT_GT(stats.recapacity_ns, 0);
+    ASSERT_GT(stats.remmap_ns, 0);
+
+    std::filesystem::remove(FILE_NAME);
+}
+
+TEST(stats, wait)
+{
+    using table_type = fixed::table<size_t, true, layout::sequence>;
+    table_type(FILE_NAME, air::lightmdb::mode_t::create_only, 1024);
+
+    table_type reader(FILE_NAME, air::lightmdb::mode_t::read_write);
+    std::thread writer([]()
+                       {
+        table_type table(FILE_NAME, air::lightmdb::mode_t::read_write);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        table.push(0); });
+
+    reader.wait(0);
+    writer.join();
+
+    detail::mmap map(FILE_NAME, air::lightmdb::mode_t::read_only);
+    auto &stats = map.get_header().stats;
+    ASSERT_EQ(stats.waits, 1);
+    ASSERT_EQ(stats.wakeups, 1);
+    if constexpr (detail::atomic<std::uint32_t>::always_has_native_wait_notify)
+    {
+        ASSERT_EQ(stats.notifies, 1);
+    }
+
+    std::filesystem::remove(FILE_NAME);
+}
+
+TEST(stats, batch_notify)
+{
+    using table_type = fixed::table<size_t, true, layout::sequence>;
+    table_type(FILE_NAME, air::lightmdb::mode_t::create_only, 1024);
+
+    table_type reader(FILE_NAME, air::lightmdb::mode_t::read_write);
+    detail::mmap map(FILE_NAME, air::lightmdb::mode_t::read_only);
+    std::thread waiter([&]()
+                       { reader.wait(99); });
+    // 没有原生 futex 时读者轮询, 不登记 waiters
+    while (detail::atomic<std::uint32_t>::always_has_native_wait_notify && map.get_header().waiters.load() == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // 批量推入只唤醒一次
+    {
+        table_type table(FILE_NAME, air::lightmdb::mode_t::read_write);
+        std::vector<size_t> values(100);
+        table.push(values.begin(), values.end());
+    }
+    waiter.join();
+
+    auto &stats = map.get_header().stats;
+    if constexpr (detail::atomic<std::uint32_t>::always_has_native_wait_notify)
+    {
+        ASSERT_EQ(stats.notifies, 1);
+        ASSERT_EQ(map.get_header().signal, 1);
+    }
+
+    std::filesystem::remove(FILE_NAME);
+}
+
+TEST(stats, variable_table)
+{
+    {
+        variable::table<> table(FILE_NAME, air::lightmdb::mode_t::create_only, 16, 8);
+        std::string val(10, 'x');
+        for (size_t i = 0; i < 10; i++)
+            table.push(val.data(), val.size());
+    }
+
+    detail::mmap map(FILE_NAME, air::lightmdb::mode_t::read_only);
+    auto &stats = map.get_header().stats;
+    ASSERT_EQ(stats.pushes, 10);
+    ASSERT_EQ(stats.bytes, 100);
+    ASSERT_EQ(stats.recapacity, 3);
+
+    // 只读映射的读者同样计数, 已发布的数据不阻塞
+    {
+        variable::table<> table(FILE_NAME, air::lightmdb::mode_t::read_only);
+        table.wait(9);
+        ASSERT_EQ(stats.waits, 0);
+
+        std::thread writer([]()
+                           {
+            variable::table<> table(FILE_NAME, air::lightmdb::mode_t::read_write);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            table.push("x", 1); });
+        table.wait(10);
+        writer.join();
+    }
+    detail::mmap index(std::string(FILE_NAME) + "i", air::lightmdb::mode_t::read_only);
+    if constexpr (detail::atomic<std::uint32_t>::always_has_native_wait_notify)
+    {
+        ASSERT_EQ(index.get_header().stats.waits, 1);
+        ASSERT_EQ(index.get_header().stats.wakeups, 1);
+    }
+
+    std::filesystem::remove(FILE_NAME);
+    std::filesystem::remove(std::string(FILE_NAME) + "i");
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
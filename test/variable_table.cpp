@@ -1,6 +1,16 @@
 #include <cstddef>
 #include <cstdint>
-#include <filesystem>
+#include <cstring>
+#include <array>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #include <gtest/gtest.h>
 #include "air/lightmdb/variable.hpp"
@@ -45,8 +55,411 @@ TEST(fixed_table, fixed_table)
         ASSERT_EQ(*(int64_t *)(*table)[i].first, i);
     }
 
-    std::filesystem::remove(FILE_NAME);
-    std::filesystem::remove(std::string(FILE_NAME) + "i");
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "i");
+}
+
+TEST(variable_table, reserve_commit)
+{
+    auto table = std::make_unique<variable::table<>>(FILE_NAME, air::lightmdb::mode_t::create_only, 16, 8);
+
+    for (int64_t i = 0; i < 10; i++)
+    {
+        auto val = table->reserve(sizeof(i));
+        ASSERT_EQ(val.offset, i * sizeof(i));
+        memcpy(val.data, &i, sizeof(i));
+        ASSERT_FALSE(table->has_value(i));
+
+        ASSERT_EQ(table->commit(val), i);
+        ASSERT_TRUE(table->has_value(i));
+        ASSERT_EQ((*table)[i].second, sizeof(i));
+        ASSERT_EQ(*(int64_t *)(*table)[i].first, i);
+    }
+
+    ASSERT_EQ(table->size().first, 10);
+    ASSERT_EQ(table->size().second, 10 * sizeof(int64_t));
+
+    table.reset();
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "i");
+}
+
+TEST(variable_table, single_producer)
+{
+    using table_type = variable::table<true, producer_t::single>;
+    auto table = std::make_unique<table_type>(FILE_NAME, air::lightmdb::mode_t::create_only, 16, 8);
+
+    for (int64_t i = 0; i < 100; i++)
+    {
+        ASSERT_EQ(table->push(&i, sizeof(i)), i);
+        ASSERT_EQ(*(int64_t *)(*table)[i].first, i);
+    }
+
+    ASSERT_EQ(table->size().first, 100);
+    ASSERT_EQ(table->size().second, 100 * sizeof(int64_t));
+
+    table->shrink_to_fit();
+    table = std::make_unique<table_type>(FILE_NAME, air::lightmdb::mode_t::read_only);
+    ASSERT_EQ(table->size().first, 100);
+    ASSERT_EQ(table->capacity().second, 100 * sizeof(int64_t));
+    for (int64_t i = 0; i < 100; i++)
+    {
+        ASSERT_EQ(*(int64_t *)(*table)[i].first, i);
+    }
+
+    table.reset();
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "i");
+}
+
+TEST(variable_table, single_producer_recover)
+{
+    using table_type = variable::table<true, producer_t::single>;
+
+    // 模拟单写入者崩溃: 不析构, 10 条数据已发布但索引与数据区的 size 都没有 flush
+    alignas(table_type) unsigned char storage[sizeof(table_type)];
+    auto crashed = new (storage) table_type(FILE_NAME, air::lightmdb::mode_t::create_only, 16, 8);
+    for (int64_t i = 0; i < 10; i++)
+        crashed->push(&i, sizeof(i));
+
+    air::lightmdb::options opts;
+    opts.recover = true;
+    table_type table(FILE_NAME, air::lightmdb::mode_t::read_write, opts);
+    ASSERT_EQ(table.size().first, 10);
+    ASSERT_EQ(table.size().second, 10 * sizeof(int64_t));
+
+    int64_t val = 10;
+    ASSERT_EQ(table.push(&val, sizeof(val)), 10);
+    for (int64_t i = 0; i <= 10; i++)
+        ASSERT_EQ(*(int64_t *)table[i].first, i);
+
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "i");
+}
+
+TEST(variable_table, chunk)
+{
+    auto table = std::make_unique<variable::table<>>(FILE_NAME, air::lightmdb::mode_t::create_only, 16, 8);
+
+    {
+        variable::table<>::chunk chunk(*table, 8, 64);
+        for (int64_t i = 0; i < 10; i++)
+            ASSERT_EQ(chunk.push(&i, sizeof(i)), i);
+
+        // 大于数据块的数据单独占用
+        std::string big(100, 'x');
+        ASSERT_EQ(chunk.push(big.data(), big.size()), 10);
+    }
+
+    ASSERT_EQ(table->size().first, 16);
+    ASSERT_EQ(table->size().second, 64 + 100 + 64);
+    for (int64_t i = 0; i < 10; i++)
+    {
+        ASSERT_FALSE(table->skipped(i));
+        ASSERT_EQ(*(int64_t *)(*table)[i].first, i);
+    }
+    ASSERT_EQ((*table)[10].second, 100);
+    for (size_t i = 11; i < 16; i++)
+    {
+        ASSERT_TRUE(table->has_value(i));
+        ASSERT_TRUE(table->skipped(i));
+    }
+
+    table.reset();
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "i");
+}
+
+TEST(variable_table, segment)
+{
+    air::lightmdb::options opts;
+    opts.segment = 64;
+    if (opts.backend == backend_t::memfd)
+    {
+        ASSERT_THROW(variable::table<>(FILE_NAME, air::lightmdb::mode_t::create_only, 64, 8, opts), std::runtime_error);
+        return;
+    }
+    auto table = std::make_unique<variable::table<>>(FILE_NAME, air::lightmdb::mode_t::create_only, 64, 8, opts);
+
+    // 24 字节的数据不会跨 64 字节的段
+    std::array<char, 24> val;
+    for (size_t i = 0; i < 20; i++)
+    {
+        val.fill(char(i));
+        table->push(&val, sizeof(val));
+        auto offset = table->index_table()[i].first;
+        ASSERT_EQ(offset / 64, (offset + sizeof(val) - 1) / 64);
+        ASSERT_EQ(memcmp((*table)[i].first, &val, sizeof(val)), 0);
+    }
+
+    ASSERT_THROW(table->push(std::string(65, 'a').data(), 65), std::runtime_error);
+
+    {
+        // 数据区每段 64 字节, 索引每段 64 / 16 条
+        detail::mmap view(std::string(FILE_NAME) + "i", air::lightmdb::mode_t::read_only, opts);
+        ASSERT_EQ(size_t(1) << view.get_header().segment_shift, 4);
+    }
+
+    table = std::make_unique<variable::table<>>(FILE_NAME, air::lightmdb::mode_t::read_only);
+    for (size_t i = 0; i < 20; i++)
+    {
+        val.fill(char(i));
+        ASSERT_EQ(memcmp((*table)[i].first, &val, sizeof(val)), 0);
+    }
+
+    table.reset();
+    for (auto name : {std::string(FILE_NAME), std::string(FILE_NAME) + "i"})
+    {
+        air::lightmdb::remove(name);
+        for (size_t i = 1; i < 16; i++)
+            air::lightmdb::remove(name + "." + std::to_string(i));
+    }
+}
+
+#if defined(__linux__)
+TEST(variable_table, reserve)
+{
+    air::lightmdb::options opts;
+    opts.reserve = size_t(1) << 30;
+    auto table = std::make_unique<variable::table<>>(FILE_NAME, air::lightmdb::mode_t::create_only, 16, 8, opts);
+
+    int64_t zero = 0;
+    table->push(&zero, sizeof(zero));
+    auto first = (*table)[0].first;
+    for (int64_t i = 1; i < 10000; i++)
+    {
+        table->push(&i, sizeof(i));
+        ASSERT_EQ(*(int64_t *)(*table)[i].first, i);
+    }
+    ASSERT_EQ(first, (*table)[0].first);
+
+    table.reset();
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "i");
+}
+#endif
+
+TEST(variable_table, sync)
+{
+    air::lightmdb::options opts;
+#if defined(__linux__)
+    opts.durability = durability_t::group_commit;
+#endif
+    {
+        variable::table<> table(FILE_NAME, air::lightmdb::mode_t::create_only, 16, 8, opts);
+        for (std::uint64_t i = 0; i < 100; i++)
+            table.push(&i, sizeof(i));
+
+        table.sync();
+        ASSERT_EQ(table.durable_size().first, 100);
+        ASSERT_EQ(table.durable_size().second, 100 * sizeof(std::uint64_t));
+
+        // 已占用但未发布的数据不计入 durable_size
+        auto val = table.reserve(sizeof(std::uint64_t));
+        table.sync();
+        ASSERT_EQ(table.durable_size().second, 100 * sizeof(std::uint64_t));
+
+        table.commit(val);
+        table.sync();
+        ASSERT_EQ(table.durable_size().first, 101);
+        ASSERT_EQ(table.durable_size().second, 101 * sizeof(std::uint64_t));
+    }
+
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "i");
+}
+
+TEST(variable_table, discard)
+{
+    using table_type = variable::table<>;
+    table_type(FILE_NAME, air::lightmdb::mode_t::create_only, 64, 64);
+
+    // 多个写入者时数据区中的位置与下标顺序不一致
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < 4; t++)
+    {
+        writers.emplace_back([t]()
+                             {
+            table_type table(FILE_NAME, air::lightmdb::mode_t::read_write);
+            for (std::uint64_t i = 0; i < 10000; i++)
+            {
+                auto val = t * 1000000 + i + 1;
+                table.push(&val, sizeof(val));
+            } });
+    }
+    for (auto &writer : writers)
+        writer.join();
+
+    table_type table(FILE_NAME, air::lightmdb::mode_t::read_write);
+    table.discard_before(30000);
+    ASSERT_EQ(table.discarded(), 30000);
+    ASSERT_EQ(table.size().first, 40000);
+
+    // 未释放的数据都不能被清零
+    for (size_t i = 30000; i < 40000; i++)
+    {
+        std::uint64_t val;
+        memcpy(&val, table[i].first, sizeof(val));
+        ASSERT_NE(val, 0);
+    }
+
+    // 已占用但尚未建立索引的数据不能被释放, 预留覆盖整页才会被打洞
+    auto pending = table.reserve(8192);
+    memset(pending.data, 0x5a, pending.size);
+    table.discard_before(40000);
+    ASSERT_EQ(table.discarded(), 40000);
+    auto index = table.commit(pending);
+    auto val = table[index];
+    ASSERT_EQ(val.second, 8192);
+    for (size_t i = 0; i < val.second; i++)
+        ASSERT_EQ(static_cast<const unsigned char *>(val.first)[i], 0x5a);
+
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "i");
+}
+
+TEST(variable_table, gather)
+{
+    struct message
+    {
+        std::uint32_t type;
+        std::uint32_t size;
+    };
+
+    variable::table<true, producer_t::single> table(FILE_NAME, air::lightmdb::mode_t::create_only, 64, 8);
+    std::string payload(100, 'p');
+    for (std::uint32_t i = 0; i < 1000; i++)
+    {
+        message header{i, i % 100};
+        ASSERT_EQ(table.push({{&header, sizeof(header)}, {payload.data(), header.size}}), i);
+    }
+
+    // 片段数不固定时使用 span, 空片段不占用空间
+    std::string tail = "tail";
+    std::vector<std::pair<const void *, size_t>> parts{{payload.data(), 3}, {nullptr, 0}, {tail.data(), tail.size()}};
+    ASSERT_EQ(table.push(parts), 1000);
+    table.flush();
+    ASSERT_EQ(table.size().second, 1000 * sizeof(message) + 99 * 100 / 2 * 10 + 7);
+
+    for (std::uint32_t i = 0; i < 1000; i++)
+    {
+        auto val = table[i];
+        message header;
+        memcpy(&header, val.first, sizeof(header));
+        ASSERT_EQ(header.type, i);
+        ASSERT_EQ(val.second, sizeof(header) + header.size);
+        ASSERT_EQ(std::string(static_cast<const char *>(val.first) + sizeof(header), header.size), payload.substr(0, i % 100));
+    }
+    auto val = table[1000];
+    ASSERT_EQ(std::string(static_cast<const char *>(val.first), val.second), "ppptail");
+
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "i");
+}
+
+TEST(variable_table, lz4)
+{
+    std::mt19937_64 random(1);
+    std::vector<std::string> inputs{"", "a", std::string(13, 'x'), std::string(100000, 'x'), "abcabcabcabcabcabcabcabcabcabc0123456789"};
+    std::string text, noise;
+    for (size_t i = 0; i < 20000; i++)
+        text += "record " + std::to_string(i % 700) + ";";
+    for (size_t i = 0; i < 70000; i++)
+        noise.push_back(static_cast<char>(random()));
+    inputs.push_back(text);
+    inputs.push_back(noise);
+
+    for (auto &input : inputs)
+    {
+        std::vector<char> compressed(detail::lz4::compress_bound(input.size()));
+        auto size = detail::lz4::compress(input.data(), input.size(), compressed.data());
+        ASSERT_LE(size, compressed.size());
+
+        std::string output(input.size(), '\0');
+        ASSERT_TRUE(detail::lz4::decompress(compressed.data(), size, output.data(), output.size()));
+        ASSERT_EQ(output, input);
+
+        // 长度不符或截断的数据被拒绝
+        if (!input.empty())
+        {
+            ASSERT_FALSE(detail::lz4::decompress(compressed.data(), size, output.data(), output.size() - 1));
+            ASSERT_FALSE(detail::lz4::decompress(compressed.data(), size - 1, output.data(), output.size()));
+        }
+    }
+    ASSERT_LT(detail::lz4::compress(text.data(), text.size(), std::vector<char>(detail::lz4::compress_bound(text.size())).data()), text.size() / 4);
+}
+
+TEST(variable_table, archive)
+{
+    using table_type = variable::table<>;
+    table_type table(FILE_NAME, air::lightmdb::mode_t::create_only, 1024, 64);
+    table_type reader(FILE_NAME, air::lightmdb::mode_t::read_only);
+    ASSERT_EQ(table.archived(), 0);
+
+    // 长度不等、可压缩的数据, 每 16 条中有 4 个跳过标记
+    auto make = [](size_t i)
+    {
+        return "record " + std::to_string(i) + std::string(i % 200, char('a' + i % 26));
+    };
+    std::vector<std::string> records;
+    for (size_t c = 0; c < 1000; c++)
+    {
+        table_type::chunk chunk(table, 16, 4096);
+        for (size_t i = 0; i < 12; i++)
+        {
+            records.push_back(make(records.size()));
+            chunk.push(records.back().data(), records.back().size());
+        }
+    }
+    auto expect = [&](table_type &t, size_t index)
+    {
+        ASSERT_EQ(t.skipped(index), index % 16 >= 12);
+        if (index % 16 < 12)
+        {
+            auto val = t[index];
+            ASSERT_EQ(std::string(static_cast<const char *>(val.first), val.second), records[index / 16 * 12 + index % 16]);
+        }
+    };
+
+    // 分两次归档, 第二次从上次归档到的位置继续
+    table.archive(5000, 64 << 10);
+    ASSERT_EQ(table.archived(), 5000);
+#if defined(__linux__)
+    {
+        // 追加中崩溃的进程留下的追加锁由下一次归档接管
+        auto pid = ::fork();
+        ASSERT_GE(pid, 0);
+        if (pid == 0)
+            ::_exit(0);
+        ASSERT_EQ(::waitpid(pid, nullptr, 0), pid);
+        detail::mmap view(std::string(FILE_NAME) + "z", air::lightmdb::mode_t::read_write);
+        view.get_header().owner = static_cast<std::uint32_t>(pid);
+    }
+#endif
+    table.archive(12000, 64 << 10);
+    ASSERT_EQ(table.archived(), 12000);
+    ASSERT_EQ(reader.archived(), 12000);
+    ASSERT_GT(table.discarded(), 0);
+
+    for (size_t i = 0; i < 16000; i += 7)
+    {
+        expect(table, i);
+        expect(reader, i);
+    }
+    for (size_t i = 0; i < 16000; i++)
+        expect(reader, i);
+
+    // 归档后的数据压缩到原来的一小部分
+    detail::block_archive archive(FILE_NAME, air::lightmdb::mode_t::read_only);
+    ASSERT_EQ(archive.archived(), 12000);
+    ASSERT_LT(archive.bytes(), 12000 * 100 / 4);
+
+    ASSERT_THROW(reader.archive(16000), std::runtime_error);
+
+    air::lightmdb::remove(FILE_NAME);
+    air::lightmdb::remove(std::string(FILE_NAME) + "i");
+    air::lightmdb::remove(std::string(FILE_NAME) + "z");
+    air::lightmdb::remove(std::string(FILE_NAME) + "zi");
 }
 
 int main(int argc, char **argv)
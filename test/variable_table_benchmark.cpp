@@ -1,6 +1,8 @@
 #include <thread>
 #include <filesystem>
 #include <array>
+#include <cstring>
+#include <vector>
 
 #include <benchmark/benchmark.h>
 
@@ -8,7 +10,7 @@
 
 using namespace air::lightmdb;
 constexpr auto FILE_NAME = "table.db";
-static auto THREADS = 16 > std::thread::hardware_concurrency() ? 16 : std::thread::hardware_concurrency();
+static auto THREADS = 32 > std::thread::hardware_concurrency() ? 32 : std::thread::hardware_concurrency();
 
 static void DoSetup(const benchmark::State &state)
 {
@@ -31,7 +33,7 @@ static void fixed_table(benchmark::State &state)
     std::array<char, I> i;
     for (auto _ : state)
     {
-        auto c = table.push(&i, sizeof(i));
+        table.push(&i, sizeof(i));
         i[0]++;
     }
 }
@@ -40,4 +42,72 @@ BENCHMARK(fixed_table<16>)->ThreadRange(1, THREADS)->Setup(DoSetup)->Teardown(Do
 BENCHMARK(fixed_table<32>)->ThreadRange(1, THREADS)->Setup(DoSetup)->Teardown(DoTeardown);
 BENCHMARK(fixed_table<64>)->ThreadRange(1, THREADS)->Setup(DoSetup)->Teardown(DoTeardown);
 
+template <size_t I>
+static void variable_table_chunk(benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    variable::table table(file, air::lightmdb::mode_t::read_write);
+    variable::table<>::chunk chunk(table, state.range(0), state.range(0) * I);
+    std::array<char, I> i;
+    for (auto _ : state)
+    {
+        chunk.push(&i, sizeof(i));
+        i[0]++;
+    }
+}
+BENCHMARK(variable_table_chunk<8>)->Arg(64)->ThreadRange(1, THREADS)->Setup(DoSetup)->Teardown(DoTeardown);
+BENCHMARK(variable_table_chunk<64>)->Arg(64)->ThreadRange(1, THREADS)->Setup(DoSetup)->Teardown(DoTeardown);
+
+template <size_t I>
+static void variable_table_single(benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    variable::table<true, producer_t::single> table(file, air::lightmdb::mode_t::read_write);
+    std::array<char, I> i;
+    for (auto _ : state)
+    {
+        table.push(&i, sizeof(i));
+        i[0]++;
+    }
+}
+BENCHMARK(variable_table_single<8>)->Setup(DoSetup)->Teardown(DoTeardown);
+BENCHMARK(variable_table_single<64>)->Setup(DoSetup)->Teardown(DoTeardown);
+
+/// 固定的消息头加上位于其他缓冲区的负载, 先拼接再写入
+template <size_t I>
+static void variable_table_concat(benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    variable::table table(file, air::lightmdb::mode_t::read_write);
+    std::array<char, 16> header{};
+    std::vector<char> payload(I);
+    for (auto _ : state)
+    {
+        std::vector<char> buffer(header.size() + payload.size());
+        memcpy(buffer.data(), header.data(), header.size());
+        memcpy(buffer.data() + header.size(), payload.data(), payload.size());
+        table.push(buffer.data(), buffer.size());
+        header[0]++;
+    }
+}
+BENCHMARK(variable_table_concat<64>)->ThreadRange(1, THREADS)->Setup(DoSetup)->Teardown(DoTeardown);
+BENCHMARK(variable_table_concat<1024>)->ThreadRange(1, THREADS)->Setup(DoSetup)->Teardown(DoTeardown);
+
+/// 分散写入, 消息头与负载直接复制到映射区
+template <size_t I>
+static void variable_table_gather(benchmark::State &state)
+{
+    auto file = std::to_string(state.threads()) + FILE_NAME;
+    variable::table table(file, air::lightmdb::mode_t::read_write);
+    std::array<char, 16> header{};
+    std::vector<char> payload(I);
+    for (auto _ : state)
+    {
+        table.push({{header.data(), header.size()}, {payload.data(), payload.size()}});
+        header[0]++;
+    }
+}
+BENCHMARK(variable_table_gather<64>)->ThreadRange(1, THREADS)->Setup(DoSetup)->Teardown(DoTeardown);
+BENCHMARK(variable_table_gather<1024>)->ThreadRange(1, THREADS)->Setup(DoSetup)->Teardown(DoTeardown);
+
 BENCHMARK_MAIN();
@@ -0,0 +1,113 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <exception>
+
+#include "air/lightmdb/core.hpp"
+
+/// 以只读方式打开 table 文件, 按固定间隔打印 header 中统计计数器的速率, 类似 vmstat
+/// 计数器只在以 AIR_LIGHTMDB_STATS 编译的进程中更新, 包括以只读方式打开的读者
+/// size 与 capacity 为数据区字节数 (header.size/header.capacity), 不是数据条数; 开始时打印元素大小 unit,
+/// packed/aligned 布局的 fixed::table 的条数为 size / unit, 变长 table 的数据文件与索引文件分别统计
+/// 用法: lightmdb-stat <file> [interval_ms = 1000] [count = 0, 0 表示一直运行]
+
+using namespace air::lightmdb;
+
+namespace
+{
+    struct snapshot
+    {
+        std::uint64_t pushes;
+        std::uint64_t bytes;
+        std::uint64_t recapacity;
+        std::uint64_t recapacity_ns;
+        std::uint64_t remmap;
+        std::uint64_t remmap_ns;
+        std::uint64_t lock_spins;
+        std::uint64_t capacity_waits;
+        std::uint64_t waits;
+        std::uint64_t wakeups;
+        std::uint64_t notifies;
+        std::uint64_t size;
+        std::uint64_t capacity;
+    };
+
+    snapshot load(detail::mmap::header &header)
+    {
+        auto &stats = header.stats;
+        return {stats.pushes.load(), stats.bytes.load(), stats.recapacity.load(), stats.recapacity_ns.load(),
+                stats.remmap.load(), stats.remmap_ns.load(), stats.lock_spins.load(), stats.capacity_waits.load(),
+                stats.waits.load(), stats.wakeups.load(), stats.notifies.load(), header.size.load(), header.capacity.load()};
+    }
+
+    /// 每次调用的平均耗时 (us)
+    double average_us(std::uint64_t ns, std::uint64_t count)
+    {
+        return count == 0 ? 0.0 : double(ns) / double(count) / 1000.0;
+    }
+
+    void print_title()
+    {
+        std::printf("%10s %10s %7s %9s %7s %9s %8s %8s %8s %8s %8s %14s %14s\n",
+                    "push/s", "MB/s", "recap/s", "recap_us", "remap/s", "remap_us",
+                    "lock/s", "cwait/s", "wait/s", "wake/s", "notify/s", "size(B)", "capacity(B)");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "usage: %s <file> [interval_ms] [count]\n", argv[0]);
+        return 1;
+    }
+
+    auto interval = std::chrono::milliseconds(argc > 2 ? std::atoll(argv[2]) : 1000);
+    auto count = argc > 3 ? std::atoll(argv[3]) : 0;
+    if (interval.count() <= 0)
+    {
+        std::fprintf(stderr, "interval must be positive\n");
+        return 1;
+    }
+
+    try
+    {
+        detail::mmap table(argv[1], air::lightmdb::mode_t::read_only);
+        std::printf("%s: unit %llu bytes\n", argv[1], static_cast<unsigned long long>(table.get_header().unit));
+        auto seconds = std::chrono::duration<double>(interval).count();
+        auto prev = load(table.get_header());
+        for (long long i = 0; count == 0 || i < count; ++i)
+        {
+            if (i % 20 == 0)
+                print_title();
+
+            std::this_thread::sleep_for(interval);
+            auto cur = load(table.get_header());
+
+            std::printf("%10.0f %10.2f %7.1f %9.1f %7.1f %9.1f %8.0f %8.0f %8.0f %8.0f %8.0f %14llu %14llu\n",
+                        (cur.pushes - prev.pushes) / seconds,
+                        (cur.bytes - prev.bytes) / seconds / (1 << 20),
+                        (cur.recapacity - prev.recapacity) / seconds,
+                        average_us(cur.recapacity_ns - prev.recapacity_ns, cur.recapacity - prev.recapacity),
+                        (cur.remmap - prev.remmap) / seconds,
+                        average_us(cur.remmap_ns - prev.remmap_ns, cur.remmap - prev.remmap),
+                        (cur.lock_spins - prev.lock_spins) / seconds,
+                        (cur.capacity_waits - prev.capacity_waits) / seconds,
+                        (cur.waits - prev.waits) / seconds,
+                        (cur.wakeups - prev.wakeups) / seconds,
+                        (cur.notifies - prev.notifies) / seconds,
+                        static_cast<unsigned long long>(cur.size),
+                        static_cast<unsigned long long>(cur.capacity));
+            std::fflush(stdout);
+            prev = cur;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "%s: %s\n", argv[1], e.what());
+        return 1;
+    }
+    return 0;
+}